@@ -0,0 +1,17 @@
+#include "aleatorio.hpp"
+#include <random>
+
+static uint64_t sementeAleatoria() {
+    std::random_device rd;
+    return (static_cast<uint64_t>(rd()) << 32) ^ rd();
+}
+
+Xoshiro256& geradorDaThread() {
+    // Cada thread tem o seu, então não há disputa nem trava no caminho da mutação
+    static thread_local Xoshiro256 gerador(sementeAleatoria());
+    return gerador;
+}
+
+void semearGeradorDaThread(uint64_t semente) {
+    geradorDaThread().semear(semente);
+}
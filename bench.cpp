@@ -0,0 +1,386 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <chrono>
+#include <atomic>
+#include <thread>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include "redeNeural.hpp"
+#include "kernels.hpp"
+#include "poolTrabalho.hpp"
+#include "evolucao.hpp"
+
+// Contagem de alocações: todo new do processo passa por aqui e os blocos alinhados da biblioteca chegam pelo
+// gancho de alocação, assim cada medição sabe quantos bytes alocou por chamada
+static std::atomic<std::size_t> bytesAlocados(0);
+
+void* operator new(std::size_t tamanho) {
+    bytesAlocados.fetch_add(tamanho, std::memory_order_relaxed);
+    void* p = std::malloc(tamanho == 0 ? 1 : tamanho);
+    if(p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+static void contarAlocacaoAlinhada(std::size_t bytes) {
+    bytesAlocados.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+/** Resultado de uma medição, uma linha do JSON */
+struct ResultadoBench {
+    std::string nome;        // identifica a medição entre execuções, usado na comparação
+    std::string operacao;
+    int entrada = 0;
+    int layers = 0;
+    int saida = 0;
+    int lote = 1;
+    int threads = 1;
+    double nsPorOp = 0;
+    double gflops = 0;
+    double bytesPorOp = 0;
+    double eficiencia = 1;   // tempo com 1 thread / (tempo com N threads x N), 1 quando não varia threads
+};
+
+/** Tempo mínimo de cada medição, em segundos */
+static double tempoMinimo = 0.2;
+
+typedef std::chrono::steady_clock Relogio;
+
+/** Função que roda funcao até somar tempoMinimo segundos e retorna o tempo e os bytes alocados por operação
+* @param operacoesPorChamada - quantas operações cada chamada de funcao conta (ex: amostras de um lote)
+*/
+template<typename Funcao>
+static void medir(Funcao funcao, double operacoesPorChamada, ResultadoBench& resultado) {
+    funcao();  // Aquecimento: caches, páginas e pool já acordado
+
+    long iteracoes = 1;
+    for(;;) {
+        std::size_t bytesAntes = bytesAlocados.load();
+        Relogio::time_point inicio = Relogio::now();
+        for(long i = 0; i < iteracoes; i++) {
+            funcao();
+        }
+        double segundos = std::chrono::duration<double>(Relogio::now() - inicio).count();
+        std::size_t bytes = bytesAlocados.load() - bytesAntes;
+
+        if(segundos >= tempoMinimo || iteracoes >= (1L << 40)) {
+            double operacoes = iteracoes * operacoesPorChamada;
+            resultado.nsPorOp = segundos * 1e9 / operacoes;
+            resultado.bytesPorOp = bytes / operacoes;
+            return;
+        }
+        // Estima quantas iterações faltam para chegar no tempo mínimo, com folga
+        double fator = segundos > 0 ? tempoMinimo / segundos * 1.2 : 10.0;
+        iteracoes = static_cast<long>(iteracoes * std::min(std::max(fator, 2.0), 100.0));
+    }
+}
+
+/** Função que retorna quantas operações de ponto flutuante (multiplicação + soma) um forward pass faz */
+static double flopsForward(const RedeNeural& rede) {
+    double flops = 0;
+    for(const auto& camada : rede.getCamadas()) {
+        flops += 2.0 * camada.entradas * camada.neuronios;
+    }
+    return flops;
+}
+
+static std::string nomear(const std::string& operacao, int entrada, int layers, int saida, int lote, int threads) {
+    std::ostringstream nome;
+    nome << operacao << "/e" << entrada << "/l" << layers << "/s" << saida << "/b" << lote << "/t" << threads;
+    return nome.str();
+}
+
+static ResultadoBench novoResultado(const std::string& operacao, int entrada, int layers, int saida, int lote, int threads) {
+    ResultadoBench resultado;
+    resultado.nome = nomear(operacao, entrada, layers, saida, lote, threads);
+    resultado.operacao = operacao;
+    resultado.entrada = entrada;
+    resultado.layers = layers;
+    resultado.saida = saida;
+    resultado.lote = lote;
+    resultado.threads = threads;
+    return resultado;
+}
+
+static void imprimir(const ResultadoBench& r) {
+    std::cout << std::left << std::setw(44) << r.nome << std::right << std::fixed
+              << std::setw(14) << std::setprecision(1) << r.nsPorOp << " ns/op"
+              << std::setw(10) << std::setprecision(2) << r.gflops << " GFLOP/s"
+              << std::setw(12) << std::setprecision(1) << r.bytesPorOp << " B/op";
+    if(r.threads > 1) std::cout << std::setw(8) << std::setprecision(2) << r.eficiencia << " efic.";
+    std::cout << std::endl;
+}
+
+/** Conjunto de medições: forward por amostra, lote, mutação, geração de pesos, truncamento e neuroevolução */
+static std::vector<ResultadoBench> executar(const std::vector<int>& threads) {
+    std::vector<ResultadoBench> resultados;
+    std::vector<double> inputs;
+    Xoshiro256 gerador(42);
+    auto adicionar = [&](const ResultadoBench& r) {
+        imprimir(r);
+        resultados.push_back(r);
+    };
+
+    // Forward de uma amostra, versão const sem alocação e versão com vector
+    for(int entrada : {16, 64, 256}) {
+        for(int layers : {1, 3}) {
+            for(int saida : {4, 32}) {
+                RedeNeural rede(entrada, layers, saida, 1);
+                AreaTrabalho area = rede.criarAreaTrabalho();
+                inputs.assign(entrada, 0.0);
+                gerador.preencherUniforme(inputs.data(), entrada, -1.0, 1.0);
+                std::vector<bool> saidas(saida);
+                bool buffer[32];
+
+                ResultadoBench r = novoResultado("iniciar", entrada, layers, saida, 1, 1);
+                medir([&]() { rede.iniciar(inputs.data(), inputs.size(), buffer, area); }, 1, r);
+                r.gflops = flopsForward(rede) / r.nsPorOp;
+                adicionar(r);
+
+                r = novoResultado("iniciar_vector", entrada, layers, saida, 1, 1);
+                medir([&]() { saidas = rede.iniciar(inputs); }, 1, r);
+                r.gflops = flopsForward(rede) / r.nsPorOp;
+                adicionar(r);
+            }
+        }
+    }
+
+    // Lote: ns por amostra conforme o tamanho do lote, devolvendo um ResultadoLote novo e reaproveitando um
+    for(int entrada : {64, 256}) {
+        RedeNeural rede(entrada, 2, 16, 2);
+        ResultadoLote resultado;
+        for(int lote : {1, 4, 16, 64, 256, 1024}) {
+            inputs.assign(static_cast<std::size_t>(lote) * entrada, 0.0);
+            gerador.preencherUniforme(inputs.data(), static_cast<int>(inputs.size()), -1.0, 1.0);
+            ResultadoBench r = novoResultado("iniciarLote", entrada, 2, 16, lote, 1);
+            medir([&]() { rede.iniciarLote(inputs, lote); }, lote, r);
+            r.gflops = flopsForward(rede) / r.nsPorOp;
+            adicionar(r);
+
+            r = novoResultado("iniciarLote_reuso", entrada, 2, 16, lote, 1);
+            medir([&]() { rede.iniciarLote(inputs.data(), lote, resultado); }, lote, r);
+            r.gflops = flopsForward(rede) / r.nsPorOp;
+            adicionar(r);
+        }
+    }
+
+    // Mutação e geração de pesos: ns por chamada em uma rede inteira
+    for(int entrada : {64, 256}) {
+        RedeNeural rede(entrada, 3, 16, 3);
+        Xoshiro256 geradorMutacao(7);
+        for(double taxa : {0.01, 0.5}) {
+            std::ostringstream operacao;
+            operacao << "modificarPesos_taxa" << taxa;
+            ResultadoBench r = novoResultado(operacao.str(), entrada, 3, 16, 1, 1);
+            medir([&]() { rede.modificarPesos(0.01, taxa, geradorMutacao); }, 1, r);
+            adicionar(r);
+        }
+        ResultadoBench r = novoResultado("gerarPesos", entrada, 3, 16, 1, 1);
+        medir([&]() { rede.gerarPesos(entrada, 3, 16); }, 1, r);
+        adicionar(r);
+    }
+
+    // Varredura de threads: avaliação em paralelo, truncamento e uma geração de neuroevolução
+    const int entrada = 128, layers = 2, saida = 16, amostras = 4096, numRedes = 64;
+    RedeNeural rede(entrada, layers, saida, 4);
+    inputs.assign(static_cast<std::size_t>(amostras) * entrada, 0.0);
+    gerador.preencherUniforme(inputs.data(), static_cast<int>(inputs.size()), -1.0, 1.0);
+    std::vector<RedeNeural> redes;
+    std::vector<const RedeNeural*> ponteiros;
+    for(int i = 0; i < numRedes; i++) redes.push_back(RedeNeural(256, 3, 16, 10 + i));
+    for(const auto& r : redes) ponteiros.push_back(&r);
+    RedeNeural media(256, 3, 16, 5);
+    const int entradaLarga = 1024;
+    RedeNeural larga(entradaLarga, 2, 16, 6);
+    AreaTrabalho areaLarga = larga.criarAreaTrabalho();
+
+    ConfiguracaoEvolucao config;
+    config.tamanhoPopulacao = 256;
+    config.numElite = 16;
+    config.semente = 1;
+
+    std::map<std::string, double> umaThread;
+    auto eficiencia = [&](ResultadoBench& r) {
+        if(r.threads == 1) umaThread[r.operacao] = r.nsPorOp;
+        if(umaThread.count(r.operacao)) r.eficiencia = umaThread[r.operacao] / (r.nsPorOp * r.threads);
+    };
+
+    for(int numThreads : threads) {
+        PoolTrabalho pool(numThreads);
+        std::vector<AreaTrabalho> areas;
+        for(int t = 0; t < pool.getNumThreads(); t++) areas.push_back(rede.criarAreaTrabalho());
+
+        ResultadoBench r = novoResultado("avaliacao_paralela", entrada, layers, saida, amostras, numThreads);
+        medir([&]() {
+            pool.paraCada(amostras, [&](int amostra, int thread) {
+                bool saidas[saida];
+                rede.iniciar(inputs.data() + static_cast<std::size_t>(amostra) * entrada, entrada, saidas, areas[thread]);
+            });
+        }, amostras, r);
+        r.gflops = flopsForward(rede) / r.nsPorOp;
+        eficiencia(r);
+        adicionar(r);
+
+        // Uma amostra só, com os neurônios de cada camada larga divididos entre as threads
+        r = novoResultado("iniciar_paralelo", entradaLarga, 2, 16, 1, numThreads);
+        medir([&]() {
+            bool saidas[16];
+            larga.iniciarParalelo(inputs.data(), entradaLarga, saidas, areaLarga, pool);
+        }, 1, r);
+        r.gflops = flopsForward(larga) / r.nsPorOp;
+        eficiencia(r);
+        adicionar(r);
+
+        r = novoResultado("truncamento", 256, 3, 16, numRedes, numThreads);
+        medir([&]() { media.truncamento(ponteiros.data(), ponteiros.size(), nullptr, &pool); }, 1, r);
+        r.gflops = 2.0 * media.getNumParametros() * numRedes / r.nsPorOp;
+        eficiencia(r);
+        adicionar(r);
+
+        config.numThreads = numThreads;
+        Neuroevolucao evolucao(32, 1, 4, config, [&](const RedeNeural& individuo, AreaTrabalho& area) {
+            bool saidas[4];
+            double valores[4], soma = 0;
+            for(int a = 0; a < 16; a++) {
+                individuo.iniciar(inputs.data() + a * 32, 32, saidas, area, valores);
+                soma += valores[0];
+            }
+            return soma;
+        });
+        r = novoResultado("neuroevolucao", 32, 1, 4, config.tamanhoPopulacao, numThreads);
+        medir([&]() { evolucao.proximaGeracao(); }, config.tamanhoPopulacao, r);
+        eficiencia(r);
+        adicionar(r);
+    }
+
+    return resultados;
+}
+
+static bool gravarJson(const std::string& caminho, const std::vector<ResultadoBench>& resultados) {
+    std::ofstream arquivo(caminho.c_str());
+    if(!arquivo) return false;
+
+    // Um resultado por linha, para a comparação poder ler sem um parser JSON completo
+    arquivo << "{\n  \"versao\": 1,\n  \"kernel\": \"" << kernelsAtivos().nome << "\",\n"
+            << "  \"threads_hardware\": " << std::thread::hardware_concurrency() << ",\n  \"resultados\": [\n";
+    arquivo << std::setprecision(6);
+    for(size_t i = 0; i < resultados.size(); i++) {
+        const ResultadoBench& r = resultados[i];
+        arquivo << "    {\"nome\": \"" << r.nome << "\", \"operacao\": \"" << r.operacao << "\", \"entrada\": " << r.entrada
+                << ", \"layers\": " << r.layers << ", \"saida\": " << r.saida << ", \"lote\": " << r.lote
+                << ", \"threads\": " << r.threads << ", \"ns_op\": " << r.nsPorOp << ", \"gflops\": " << r.gflops
+                << ", \"bytes_por_op\": " << r.bytesPorOp << ", \"eficiencia\": " << r.eficiencia << "}"
+                << (i + 1 < resultados.size() ? "," : "") << "\n";
+    }
+    arquivo << "  ]\n}\n";
+    return static_cast<bool>(arquivo);
+}
+
+/** Função que lê nome -> ns_op de um arquivo gerado por gravarJson(). Retorna false se não conseguir abrir */
+static bool lerJson(const std::string& caminho, std::map<std::string, double>& tempos) {
+    std::ifstream arquivo(caminho.c_str());
+    if(!arquivo) return false;
+
+    std::string linha;
+    while(std::getline(arquivo, linha)) {
+        std::size_t nome = linha.find("\"nome\": \"");
+        std::size_t ns = linha.find("\"ns_op\": ");
+        if(nome == std::string::npos || ns == std::string::npos) continue;
+        nome += 9;
+        std::size_t fimNome = linha.find('"', nome);
+        tempos[linha.substr(nome, fimNome - nome)] = std::atof(linha.c_str() + ns + 9);
+    }
+    return true;
+}
+
+/** Compara dois arquivos de resultado. Retorna o código de saída: 1 se alguma medição ficou mais lenta que a tolerância */
+static int comparar(const std::string& base, const std::string& novo, double tolerancia) {
+    std::map<std::string, double> temposBase, temposNovo;
+    if(!lerJson(base, temposBase) || !lerJson(novo, temposNovo)) {
+        std::cerr << "Não foi possível ler os arquivos de resultado" << std::endl;
+        return 2;
+    }
+
+    int regressoes = 0;
+    for(const auto& item : temposNovo) {
+        auto anterior = temposBase.find(item.first);
+        if(anterior == temposBase.end() || anterior->second <= 0) continue;
+
+        double razao = item.second / anterior->second;
+        const char* estado = razao > 1.0 + tolerancia ? "REGRESSÃO" : (razao < 1.0 - tolerancia ? "melhora" : "ok");
+        if(razao > 1.0 + tolerancia) regressoes++;
+        std::cout << std::left << std::setw(44) << item.first << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(12) << anterior->second << " -> " << std::setw(12) << item.second << " ns/op  "
+                  << std::setprecision(2) << std::setw(6) << razao << "x  " << estado << std::endl;
+    }
+
+    std::cout << std::endl << regressoes << " regressão(ões) acima de " << tolerancia * 100 << "%" << std::endl;
+    return regressoes > 0 ? 1 : 0;
+}
+
+static void uso() {
+    std::cout << "Uso:\n"
+              << "  bench_rede [--saida arquivo.json] [--rapido] [--threads N]\n"
+              << "  bench_rede --comparar base.json novo.json [--tolerancia 0.10]\n";
+}
+
+int main(int argc, char** argv) {
+    std::string saida = "bench_rede.json";
+    int maxThreads = static_cast<int>(std::thread::hardware_concurrency());
+    double tolerancia = 0.10;
+    std::vector<std::string> comparacao;
+
+    for(int i = 1; i < argc; i++) {
+        std::string opcao = argv[i];
+        if(opcao == "--saida" && i + 1 < argc) {
+            saida = argv[++i];
+        } else if(opcao == "--rapido") {
+            tempoMinimo = 0.02;
+        } else if(opcao == "--threads" && i + 1 < argc) {
+            maxThreads = std::atoi(argv[++i]);
+        } else if(opcao == "--tolerancia" && i + 1 < argc) {
+            tolerancia = std::atof(argv[++i]);
+        } else if(opcao == "--comparar" && i + 2 < argc) {
+            comparacao.push_back(argv[++i]);
+            comparacao.push_back(argv[++i]);
+        } else {
+            uso();
+            return 2;
+        }
+    }
+
+    if(!comparacao.empty()) {
+        return comparar(comparacao[0], comparacao[1], tolerancia);
+    }
+
+    // 1, 2, 4, ... até o número de threads da máquina, e o próprio número se não for potência de 2
+    std::vector<int> threads;
+    maxThreads = std::max(maxThreads, 1);
+    for(int t = 1; t <= maxThreads; t *= 2) threads.push_back(t);
+    if(threads.back() != maxThreads) threads.push_back(maxThreads);
+
+    std::cout << "Kernel: " << kernelsAtivos().nome << ", threads: até " << maxThreads << std::endl << std::endl;
+    definirGanchoAlocacao(contarAlocacaoAlinhada);
+    std::vector<ResultadoBench> resultados = executar(threads);
+
+    if(!gravarJson(saida, resultados)) {
+        std::cerr << "Não foi possível gravar " << saida << std::endl;
+        return 2;
+    }
+    std::cout << std::endl << "Resultados gravados em " << saida << std::endl;
+    return 0;
+}
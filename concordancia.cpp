@@ -0,0 +1,48 @@
+#include "concordancia.hpp"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+
+RelatorioConcordancia medirConcordancia(const RedeNeural& referencia, const FuncaoInferencia& aproximada,
+                                        const std::vector<double>& inputs, int amostras) {
+    RelatorioConcordancia relatorio;
+    const int entrada = referencia.getEntrada();
+    const int saida = referencia.getSaida();
+    if(amostras <= 0 || inputs.size() != static_cast<std::size_t>(amostras) * entrada) {
+        return relatorio;
+    }
+
+    AreaTrabalho area = referencia.criarAreaTrabalho();
+    std::unique_ptr<bool[]> saidasReferencia(new bool[saida]), saidasAproximadas(new bool[saida]);
+    std::vector<double> valoresReferencia(saida), valoresAproximados(saida);
+    std::vector<std::size_t> diferentes(saida, 0);
+    std::size_t amostrasIguais = 0;
+
+    for(int a = 0; a < amostras; a++) {
+        const double* amostra = inputs.data() + static_cast<std::size_t>(a) * entrada;
+        referencia.iniciar(amostra, entrada, saidasReferencia.get(), area, valoresReferencia.data());
+        if(!aproximada(amostra, saidasAproximadas.get(), valoresAproximados.data())) {
+            return RelatorioConcordancia();
+        }
+
+        bool iguais = true;
+        for(int n = 0; n < saida; n++) {
+            if(saidasReferencia[n] != saidasAproximadas[n]) {
+                diferentes[n]++;
+                iguais = false;
+            }
+            relatorio.erroMaximo = std::max(relatorio.erroMaximo, std::abs(valoresReferencia[n] - valoresAproximados[n]));
+        }
+        if(iguais) amostrasIguais++;
+    }
+
+    relatorio.amostras = amostras;
+    std::size_t totalDiferentes = 0;
+    for(int n = 0; n < saida; n++) {
+        relatorio.discordanciaPorSaida.push_back(static_cast<double>(diferentes[n]) / amostras);
+        totalDiferentes += diferentes[n];
+    }
+    relatorio.discordanciaTotal = static_cast<double>(totalDiferentes) / (static_cast<double>(amostras) * saida);
+    relatorio.amostrasIguais = static_cast<double>(amostrasIguais) / amostras;
+    return relatorio;
+}
@@ -0,0 +1,365 @@
+#include "conjuntoDados.hpp"
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char MAGICA_AMOSTRAS[8] = {'R', 'E', 'D', 'E', 'A', 'M', 'O', 'S'};
+
+bool salvarAmostras(const std::string& caminho, const double* inputs, const double* alvos, std::size_t amostras,
+                    int entrada, int saida) {
+    if(entrada <= 0 || saida < 0 || (saida > 0 && alvos == nullptr)) return false;
+
+    CabecalhoAmostras cabecalho;
+    std::memset(&cabecalho, 0, sizeof(cabecalho));
+    std::memcpy(cabecalho.magica, MAGICA_AMOSTRAS, sizeof(MAGICA_AMOSTRAS));
+    cabecalho.versao = VERSAO_AMOSTRAS;
+    cabecalho.marcaEndian = MARCA_ENDIAN;
+    cabecalho.entrada = static_cast<uint32_t>(entrada);
+    cabecalho.saida = static_cast<uint32_t>(saida);
+    cabecalho.numAmostras = amostras;
+    cabecalho.tamanhoArquivo = sizeof(CabecalhoAmostras) + amostras * (entrada + saida) * sizeof(double);
+
+    std::ofstream arquivo(caminho.c_str(), std::ios::binary | std::ios::trunc);
+    if(!arquivo) return false;
+
+    arquivo.write(reinterpret_cast<const char*>(&cabecalho), sizeof(cabecalho));
+    for(std::size_t i = 0; i < amostras; i++) {
+        arquivo.write(reinterpret_cast<const char*>(inputs + i * entrada), entrada * sizeof(double));
+        arquivo.write(reinterpret_cast<const char*>(alvos + i * saida), saida * sizeof(double));
+    }
+    return static_cast<bool>(arquivo);
+}
+
+ConjuntoMapeado::ConjuntoMapeado() : mapa(nullptr), tamanho(0), dados(nullptr), numAmostras(0), entrada(0), saida(0) {
+}
+
+ConjuntoMapeado::~ConjuntoMapeado() {
+    fechar();
+}
+
+void ConjuntoMapeado::fechar() {
+    if(mapa != nullptr) {
+        munmap(mapa, tamanho);
+        mapa = nullptr;
+        tamanho = 0;
+    }
+    dados = nullptr;
+    numAmostras = 0;
+    entrada = 0;
+    saida = 0;
+}
+
+bool ConjuntoMapeado::falhar(const std::string& mensagem) {
+    fechar();
+    erro = mensagem;
+    return false;
+}
+
+bool ConjuntoMapeado::abrir(const std::string& caminho) {
+    fechar();
+    erro.clear();
+
+    int descritor = ::open(caminho.c_str(), O_RDONLY);
+    if(descritor < 0) return falhar("não foi possível abrir " + caminho);
+
+    struct stat info;
+    if(fstat(descritor, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(CabecalhoAmostras))) {
+        ::close(descritor);
+        return falhar("arquivo menor que o cabeçalho");
+    }
+
+    tamanho = static_cast<std::size_t>(info.st_size);
+    void* endereco = mmap(nullptr, tamanho, PROT_READ, MAP_PRIVATE, descritor, 0);
+    ::close(descritor);  // O mapeamento continua válido sem o descritor
+    if(endereco == MAP_FAILED) {
+        tamanho = 0;
+        return falhar("mmap falhou");
+    }
+    mapa = endereco;
+
+    const char* base = static_cast<const char*>(mapa);
+    CabecalhoAmostras cabecalho;
+    std::memcpy(&cabecalho, base, sizeof(cabecalho));
+
+    if(std::memcmp(cabecalho.magica, MAGICA_AMOSTRAS, sizeof(MAGICA_AMOSTRAS)) != 0) {
+        return falhar("não é um arquivo de amostras");
+    }
+    if(cabecalho.marcaEndian != MARCA_ENDIAN) {
+        return falhar("amostras gravadas com outra ordem de bytes");
+    }
+    if(cabecalho.versao != VERSAO_AMOSTRAS) {
+        return falhar("versão de amostras não suportada");
+    }
+    if(cabecalho.entrada == 0 || cabecalho.entrada > 1u << 24 || cabecalho.saida > 1u << 24) {
+        return falhar("número de colunas inválido");
+    }
+    const uint64_t bytesAmostra = (static_cast<uint64_t>(cabecalho.entrada) + cabecalho.saida) * sizeof(double);
+    if(cabecalho.tamanhoArquivo != tamanho ||
+       cabecalho.numAmostras != (tamanho - sizeof(CabecalhoAmostras)) / bytesAmostra ||
+       (tamanho - sizeof(CabecalhoAmostras)) % bytesAmostra != 0) {
+        return falhar("arquivo truncado");
+    }
+
+    // O cabeçalho tem 64 bytes e o mapa começa numa página, então os doubles ficam alinhados
+    dados = reinterpret_cast<const double*>(base + sizeof(CabecalhoAmostras));
+    numAmostras = static_cast<std::size_t>(cabecalho.numAmostras);
+    entrada = static_cast<int>(cabecalho.entrada);
+    saida = static_cast<int>(cabecalho.saida);
+    return true;
+}
+
+void ConjuntoMapeado::preCarregar(std::size_t inicio, std::size_t quantidade) const {
+    if(mapa == nullptr || inicio >= numAmostras) return;
+    quantidade = std::min(quantidade, numAmostras - inicio);
+
+    const std::size_t pagina = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    const char* comeco = reinterpret_cast<const char*>(getInputs(inicio));
+    const char* fim = reinterpret_cast<const char*>(getInputs(inicio + quantidade));
+    const std::size_t deslocamento = (comeco - static_cast<const char*>(mapa)) / pagina * pagina;
+    madvise(static_cast<char*>(mapa) + deslocamento, fim - (static_cast<const char*>(mapa) + deslocamento), MADV_WILLNEED);
+}
+
+LeitorMapeado::LeitorMapeado() : posicao(0) {
+}
+
+bool LeitorMapeado::abrir(const std::string& caminho) {
+    posicao = 0;
+    if(!conjunto.abrir(caminho)) {
+        erro = conjunto.getErro();
+        return false;
+    }
+    erro.clear();
+    return true;
+}
+
+int LeitorMapeado::ler(double* inputs, double* alvos, int maximo) {
+    const std::size_t total = conjunto.getNumAmostras();
+    if(posicao >= total || maximo <= 0) return 0;
+
+    const std::size_t quantidade = std::min(static_cast<std::size_t>(maximo), total - posicao);
+    // Enquanto este lote é copiado, o sistema já lê as páginas do próximo
+    conjunto.preCarregar(posicao + quantidade, quantidade);
+
+    const int entrada = conjunto.getEntrada();
+    const int saida = conjunto.getSaida();
+    if(saida == 0) {
+        std::memcpy(inputs, conjunto.getInputs(posicao), quantidade * entrada * sizeof(double));
+    } else {
+        for(std::size_t i = 0; i < quantidade; i++) {
+            std::memcpy(inputs + i * entrada, conjunto.getInputs(posicao + i), entrada * sizeof(double));
+            std::memcpy(alvos + i * saida, conjunto.getAlvos(posicao + i), saida * sizeof(double));
+        }
+    }
+    posicao += quantidade;
+    return static_cast<int>(quantidade);
+}
+
+bool LeitorMapeado::reiniciar() {
+    posicao = 0;
+    conjunto.preCarregar(0, 1);
+    return erro.empty();
+}
+
+LeitorCsv::LeitorCsv(int entrada, int saida) : numLinha(0), procurarCabecalho(true), entrada(entrada), saida(saida) {
+}
+
+bool LeitorCsv::abrir(const std::string& caminho) {
+    this->caminho = caminho;
+    if(arquivo.is_open()) arquivo.close();
+    arquivo.clear();
+    arquivo.open(caminho.c_str(), std::ios::binary);
+    numLinha = 0;
+    procurarCabecalho = true;
+    if(!arquivo) {
+        erro = "não foi possível abrir " + caminho;
+        return false;
+    }
+    erro.clear();
+    return true;
+}
+
+bool LeitorCsv::reiniciar() {
+    return abrir(caminho);
+}
+
+static const char* pularEspacos(const char* p) {
+    while(*p == ' ' || *p == '\t' || *p == '\r') p++;
+    return p;
+}
+
+bool LeitorCsv::converterLinha(double* inputs, double* alvos) {
+    const char* p = linha.c_str();
+    const int colunas = entrada + saida;
+    for(int c = 0; c < colunas; c++) {
+        char* fim;
+        double valor = std::strtod(p, &fim);
+        if(fim == p) return false;
+        if(c < entrada) inputs[c] = valor;
+        else alvos[c - entrada] = valor;
+
+        p = pularEspacos(fim);
+        if(c + 1 < colunas) {
+            if(*p != ',') return false;
+            p++;
+        }
+    }
+    return *p == '\0';
+}
+
+int LeitorCsv::ler(double* inputs, double* alvos, int maximo) {
+    if(!erro.empty() || !arquivo.is_open()) return 0;
+
+    int lidas = 0;
+    while(lidas < maximo && std::getline(arquivo, linha)) {
+        numLinha++;
+        const char* inicio = pularEspacos(linha.c_str());
+        if(*inicio == '\0') continue;
+
+        if(procurarCabecalho) {
+            // Cabeçalho: a primeira linha não vazia não começa com um número
+            procurarCabecalho = false;
+            char* fim;
+            std::strtod(inicio, &fim);
+            if(fim == inicio) continue;
+        }
+
+        if(!converterLinha(inputs + static_cast<std::size_t>(lidas) * entrada,
+                           alvos + static_cast<std::size_t>(lidas) * saida)) {
+            erro = "linha " + std::to_string(numLinha) + ": esperava " + std::to_string(entrada + saida) +
+                   " valores separados por vírgula";
+            break;
+        }
+        lidas++;
+    }
+    return lidas;
+}
+
+FluxoLotes::FluxoLotes(std::unique_ptr<LeitorAmostras> leitor, int tamanhoLote, int profundidade)
+    : leitor(std::move(leitor)), tamanhoLote(std::max(tamanhoLote, 1)), emUso(-1), lidas(0), fim(false), parar(false) {
+    lotes.resize(std::max(profundidade, 2));
+    for(auto& lote : lotes) {
+        lote.entrada = this->leitor->getEntrada();
+        lote.saida = this->leitor->getSaida();
+        lote.inputs.assign(static_cast<std::size_t>(this->tamanhoLote) * lote.entrada, 0.0);
+        lote.alvos.assign(static_cast<std::size_t>(this->tamanhoLote) * lote.saida, 0.0);
+    }
+    iniciarLeitura();
+}
+
+FluxoLotes::~FluxoLotes() {
+    pararLeitura();
+}
+
+void FluxoLotes::iniciarLeitura() {
+    prontos.clear();
+    livres.clear();
+    for(std::size_t i = 0; i < lotes.size(); i++) {
+        livres.push_back(static_cast<int>(i));
+    }
+    emUso = -1;
+    lidas = 0;
+    fim = false;
+    parar = false;
+    leitura = std::thread(&FluxoLotes::ler, this);
+}
+
+void FluxoLotes::pararLeitura() {
+    {
+        std::lock_guard<std::mutex> trava(this->trava);
+        parar = true;
+    }
+    temLivre.notify_all();
+    if(leitura.joinable()) {
+        leitura.join();
+    }
+}
+
+void FluxoLotes::ler() {
+    while(true) {
+        int indice;
+        {
+            std::unique_lock<std::mutex> trava(this->trava);
+            temLivre.wait(trava, [this]() { return parar || !livres.empty(); });
+            if(parar) return;
+            indice = livres.back();
+            livres.pop_back();
+        }
+
+        // A leitura e a conversão acontecem fora da trava, enquanto quem consome usa os outros lotes
+        LoteAmostras& lote = lotes[indice];
+        lote.amostras = leitor->ler(lote.inputs.data(), lote.alvos.data(), tamanhoLote);
+        lote.primeira = lidas;
+        lidas += lote.amostras;
+
+        {
+            std::lock_guard<std::mutex> trava(this->trava);
+            if(lote.amostras == 0) {
+                livres.push_back(indice);
+                fim = true;
+            } else {
+                prontos.push_back(indice);
+            }
+        }
+        temPronto.notify_one();
+        if(lote.amostras == 0) return;
+    }
+}
+
+const LoteAmostras* FluxoLotes::proximo() {
+    std::unique_lock<std::mutex> trava(this->trava);
+    if(emUso >= 0) {
+        livres.push_back(emUso);
+        emUso = -1;
+        temLivre.notify_one();
+    }
+
+    temPronto.wait(trava, [this]() { return fim || !prontos.empty(); });
+    if(prontos.empty()) return nullptr;
+
+    emUso = prontos.front();
+    prontos.pop_front();
+    return &lotes[emUso];
+}
+
+bool FluxoLotes::reiniciar() {
+    pararLeitura();
+    if(!leitor->reiniciar()) {
+        // Sem leitura nova: proximo() passa a retornar nullptr
+        prontos.clear();
+        emUso = -1;
+        fim = true;
+        return false;
+    }
+    iniciarLeitura();
+    return true;
+}
+
+bool avaliarConjunto(const std::vector<const RedeNeural*>& redes, FluxoLotes& fluxo, const FuncaoPontuacao& pontuar,
+                     PoolTrabalho& pool, std::vector<double>& aptidoes) {
+    aptidoes.assign(redes.size(), 0.0);
+    for(const RedeNeural* rede : redes) {
+        if(rede->getEntrada() != fluxo.getEntrada() || (fluxo.getSaida() > 0 && rede->getSaida() != fluxo.getSaida())) {
+            return false;
+        }
+    }
+
+    // Um resultado por thread, reaproveitado por todas as redes e lotes que ela calcula
+    std::vector<ResultadoLote> resultados(pool.getNumThreads());
+    while(const LoteAmostras* lote = fluxo.proximo()) {
+        pool.paraCada(static_cast<int>(redes.size()), [&](int r, int thread) {
+            ResultadoLote& resultado = resultados[thread];
+            redes[r]->iniciarLote(lote->inputs.data(), lote->amostras, resultado);
+            const int saida = redes[r]->getSaida();
+            double soma = 0.0;
+            for(int a = 0; a < lote->amostras; a++) {
+                soma += pontuar(&resultado.valores[static_cast<std::size_t>(a) * saida], lote->getAlvos(a), saida);
+            }
+            aptidoes[r] += soma;
+        });
+    }
+    return fluxo.getErro().empty();
+}
@@ -0,0 +1,110 @@
+#include "evolucao.hpp"
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+
+Neuroevolucao::Neuroevolucao(int entrada, int numLayers, int saida, const ConfiguracaoEvolucao& config, FuncaoAptidao aptidao)
+    : config(config), aptidao(aptidao), pool(new PoolTrabalho(config.numThreads)) {
+    semente = config.semente != 0 ? config.semente : geradorDaThread().proximo();
+    gerador.semear(semente);
+    this->config.tamanhoPopulacao = std::max(1, config.tamanhoPopulacao);
+    this->config.numElite = std::min(std::max(1, config.numElite), this->config.tamanhoPopulacao);
+    geracao = 0;
+    indiceMelhor = 0;
+
+    populacao.reserve(this->config.tamanhoPopulacao);
+    for(int i = 0; i < this->config.tamanhoPopulacao; i++) {
+        populacao.push_back(RedeNeural(entrada, numLayers, saida, misturarSemente(semente, i)));
+    }
+    proxima = populacao;
+    aptidoes.assign(populacao.size(), 0.0);
+    for(int t = 0; t < pool->getNumThreads(); t++) {
+        areas.push_back(populacao[0].criarAreaTrabalho());
+    }
+}
+
+void Neuroevolucao::avaliar() {
+    // Cada indivíduo é uma tarefa: o pool redistribui quando alguns demoram mais que outros
+    pool->paraCada(static_cast<int>(populacao.size()), [&](int indice, int thread) {
+        aptidoes[indice] = aptidao(populacao[indice], areas[thread]);
+    });
+}
+
+EstatisticasGeracao Neuroevolucao::proximaGeracao() {
+    typedef std::chrono::steady_clock Relogio;
+    EstatisticasGeracao estatisticas;
+    estatisticas.geracao = geracao;
+
+    Relogio::time_point inicio = Relogio::now();
+    avaliar();
+    Relogio::time_point fimAvaliacao = Relogio::now();
+
+    // Ordena do mais apto para o menos apto, empates ficam na ordem da população
+    std::vector<int> ordem(populacao.size());
+    std::iota(ordem.begin(), ordem.end(), 0);
+    std::stable_sort(ordem.begin(), ordem.end(), [&](int a, int b) { return aptidoes[a] > aptidoes[b]; });
+
+    estatisticas.melhorAptidao = aptidoes[ordem[0]];
+    estatisticas.mediaAptidao = std::accumulate(aptidoes.begin(), aptidoes.end(), 0.0) / aptidoes.size();
+
+    // Escolhe o pai de cada filho aqui, na thread principal, e deixa a cópia e a mutação para o pool
+    const int numElite = config.numElite;
+    int primeiroMutante = numElite;
+    std::vector<int> pais(populacao.size());
+    for(int i = 0; i < numElite; i++) {
+        pais[i] = ordem[i];
+    }
+    for(size_t i = numElite; i < pais.size(); i++) {
+        pais[i] = ordem[gerador.intervalo(numElite)];
+    }
+
+    // Filho com a média dos pesos da elite
+    bool temTruncado = config.usarTruncamento && numElite > 1 && numElite < config.tamanhoPopulacao;
+    if(temTruncado) {
+        std::vector<const RedeNeural*> elite;
+        std::vector<double> aptidoesElite;
+        for(int i = 0; i < numElite; i++) {
+            elite.push_back(&populacao[ordem[i]]);
+            aptidoesElite.push_back(aptidoes[ordem[i]]);
+        }
+        // A média ponderada falha se houver aptidão negativa, nesse caso cai para a média simples
+        bool ponderado = config.truncamentoPonderado &&
+            proxima[numElite].truncamento(elite.data(), elite.size(), aptidoesElite.data(), pool.get());
+        if(!ponderado) {
+            proxima[numElite].truncamento(elite.data(), elite.size(), nullptr, pool.get());
+        }
+        primeiroMutante = numElite + 1;
+    }
+
+    // As atribuições reaproveitam a memória de proxima, que já tem a mesma topologia.
+    // Cada filho muta com um gerador derivado de (semente, geração, índice), então o resultado não depende de qual thread o executou
+    const double valorMutacao = config.valorMutacao;
+    const double taxaMutacao = config.taxaMutacao;
+    const uint64_t sementeGeracao = misturarSemente(semente, 0x100000000ull + geracao);
+    pool->paraCada(static_cast<int>(populacao.size()), [&](int indice, int) {
+        if(temTruncado && indice == numElite) return;
+        proxima[indice] = populacao[pais[indice]];
+        if(indice >= primeiroMutante) {
+            Xoshiro256 geradorFilho(misturarSemente(sementeGeracao, indice));
+            proxima[indice].modificarPesos(valorMutacao, taxaMutacao, geradorFilho);
+        }
+    });
+    populacao.swap(proxima);
+    indiceMelhor = 0;  // a elite fica no início, em ordem de aptidão
+    geracao++;
+
+    Relogio::time_point fim = Relogio::now();
+    estatisticas.segundosAvaliacao = std::chrono::duration<double>(fimAvaliacao - inicio).count();
+    estatisticas.segundosReproducao = std::chrono::duration<double>(fim - fimAvaliacao).count();
+    estatisticas.individuosPorSegundo = estatisticas.segundosAvaliacao > 0
+        ? populacao.size() / estatisticas.segundosAvaliacao : 0.0;
+    return estatisticas;
+}
+
+std::vector<EstatisticasGeracao> Neuroevolucao::evoluir(int geracoes) {
+    std::vector<EstatisticasGeracao> historico;
+    for(int g = 0; g < geracoes; g++) {
+        historico.push_back(proximaGeracao());
+    }
+    return historico;
+}
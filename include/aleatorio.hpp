@@ -0,0 +1,121 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+
+/** Gerador xoshiro256** (Blackman e Vigna): rápido, estado de 32 bytes, período 2^256 - 1.
+* Segue a interface de gerador da biblioteca padrão, então também funciona com as distribuições de <random>.
+*/
+class Xoshiro256 {
+private:
+    uint64_t estado[4];
+
+    static uint64_t rotacionar(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+public:
+    typedef uint64_t result_type;
+
+    explicit Xoshiro256(uint64_t semente = 0x9E3779B97F4A7C15ull) {
+        semear(semente);
+    }
+
+    /** Função que reinicia o gerador a partir de uma semente, expandida com splitmix64 para os 4 words do estado */
+    void semear(uint64_t semente) {
+        for(int i = 0; i < 4; i++) {
+            semente += 0x9E3779B97F4A7C15ull;
+            uint64_t z = semente;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            estado[i] = z ^ (z >> 31);
+        }
+    }
+
+    /** Função que retorna os próximos 64 bits aleatórios */
+    uint64_t proximo() {
+        const uint64_t resultado = rotacionar(estado[1] * 5, 7) * 9;
+        const uint64_t t = estado[1] << 17;
+        estado[2] ^= estado[0];
+        estado[3] ^= estado[1];
+        estado[1] ^= estado[2];
+        estado[0] ^= estado[3];
+        estado[2] ^= t;
+        estado[3] = rotacionar(estado[3], 45);
+        return resultado;
+    }
+
+    /** Função que retorna um double uniforme em [0, 1), usando os 53 bits mais altos */
+    double uniforme() {
+        return (proximo() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    /** Função que retorna um double uniforme em [minimo, maximo) */
+    double uniforme(double minimo, double maximo) {
+        return minimo + (maximo - minimo) * uniforme();
+    }
+
+    /** Função que preenche destino com quantidade doubles uniformes em [minimo, maximo) */
+    void preencherUniforme(double* destino, int quantidade, double minimo, double maximo) {
+        const double escala = (maximo - minimo) * (1.0 / 9007199254740992.0);
+        for(int i = 0; i < quantidade; i++) {
+            destino[i] = minimo + (proximo() >> 11) * escala;
+        }
+    }
+
+    /** Função que retorna um inteiro uniforme em [0, limite) */
+    uint32_t intervalo(uint32_t limite) {
+        return static_cast<uint32_t>(((proximo() >> 32) * limite) >> 32);
+    }
+
+    result_type operator()() { return proximo(); }
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return std::numeric_limits<uint64_t>::max(); }
+};
+
+/** Sorteio da mutação de pesos, compartilhado por RedeNeural::modificarPesos() e RedeCompartilhada::mutar()
+* para que as duas consumam o gerador da mesma forma: cada peso é alterado com probabilidade taxa, sorteando
+* direto a distância geométrica até o próximo alterado, e a alteração é +-valor com o sinal em um bit, limitada a [-1, 1].
+*/
+class SorteioMutacao {
+private:
+    Xoshiro256& gerador;
+    double valor;
+    double taxa;
+    double logNaoAlterar;
+public:
+    /** Cria o sorteio. taxa deve ser maior que 0 */
+    SorteioMutacao(Xoshiro256& gerador, double valor, double taxa)
+        : gerador(gerador), valor(valor), taxa(taxa), logNaoAlterar(taxa < 1.0 ? std::log1p(-taxa) : 0.0) {
+    }
+
+    /** Função que retorna quantos pesos pular até o próximo alterado: floor(log(u) / log(1 - taxa)), com u em (0, 1] */
+    std::size_t pular() {
+        if(taxa >= 1.0) return 0;
+        double u = 1.0 - gerador.uniforme();
+        double distancia = std::floor(std::log(u) / logNaoAlterar);
+        return distancia < 1e15 ? static_cast<std::size_t>(distancia) : static_cast<std::size_t>(1e15);
+    }
+
+    /** Função que retorna o peso somado de +-valor, limitado ao intervalo [-1, 1] */
+    double alterar(double peso) {
+        peso += (gerador.proximo() >> 63) ? valor : -valor;
+        if(peso > 1.0) peso = 1.0;
+        else if(peso < -1.0) peso = -1.0;
+        return peso;
+    }
+};
+
+/** Função que combina duas sementes em uma nova, usada para derivar fluxos independentes (ex: geração e indivíduo) de uma semente só */
+inline uint64_t misturarSemente(uint64_t semente, uint64_t indice) {
+    uint64_t z = semente ^ (indice + 0x9E3779B97F4A7C15ull + (semente << 6) + (semente >> 2));
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/** Função que retorna o gerador da thread atual. Na primeira chamada de cada thread ele é semeado com std::random_device */
+Xoshiro256& geradorDaThread();
+
+/** Função que semeia o gerador da thread atual, deixando gerarPesos() e modificarPesos() reproduzíveis nesta thread */
+void semearGeradorDaThread(uint64_t semente);
@@ -0,0 +1,22 @@
+#pragma once
+#include <vector>
+#include <functional>
+#include "redeNeural.hpp"
+
+/** Relatório de quanto uma versão aproximada da rede (precisão reduzida, podada) concorda com a rede double de referência */
+struct RelatorioConcordancia {
+    std::size_t amostras = 0;
+    std::vector<double> discordanciaPorSaida;  // fração das amostras em que cada saída booleana difere da referência
+    double discordanciaTotal = 0.0;            // fração de todas as saídas (amostras x saida) que diferem
+    double amostrasIguais = 0.0;               // fração das amostras com todas as saídas iguais
+    double erroMaximo = 0.0;                   // maior |valor - valor de referência| na camada de saída
+};
+
+/** Calcula uma amostra na versão aproximada: preenche saidas e valores (saida elementos cada). Retorna false em caso de erro */
+typedef std::function<bool(const double* inputs, bool* saidas, double* valores)> FuncaoInferencia;
+
+/** Função que roda a referência e a versão aproximada nas mesmas amostras e compara as saídas
+* @param inputs - matriz amostras x entrada em row-major
+*/
+RelatorioConcordancia medirConcordancia(const RedeNeural& referencia, const FuncaoInferencia& aproximada,
+                                        const std::vector<double>& inputs, int amostras);
@@ -0,0 +1,253 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <fstream>
+#include <cstdint>
+#include "redeNeural.hpp"
+#include "modelo.hpp"
+#include "poolTrabalho.hpp"
+
+/** Formato binário de amostras, versão 1, na ordem de bytes de quem gravou (marcaEndian, igual ao modelo):
+*   cabeçalho (64 bytes) | amostras, cada uma com entrada inputs seguidos de saida alvos, em double
+* Sem preenchimento entre amostras, então o arquivo pode ser gravado em sequência por quem gera os dados.
+*/
+constexpr uint32_t VERSAO_AMOSTRAS = 1;
+
+struct CabecalhoAmostras {
+    char magica[8];           // "REDEAMOS"
+    uint32_t versao;          // VERSAO_AMOSTRAS
+    uint32_t marcaEndian;     // MARCA_ENDIAN na ordem de bytes de quem gravou
+    uint32_t entrada;         // inputs por amostra
+    uint32_t saida;           // alvos por amostra, 0 se o arquivo só tiver inputs
+    uint64_t numAmostras;
+    uint64_t tamanhoArquivo;
+    uint8_t reservado[24];
+};
+
+/** Função que grava amostras no formato binário. Retorna false se não conseguir gravar
+* @param inputs - matriz amostras x entrada em row-major
+* @param alvos - matriz amostras x saida em row-major, pode ser nullptr se saida for 0
+*/
+bool salvarAmostras(const std::string& caminho, const double* inputs, const double* alvos, std::size_t amostras,
+                    int entrada, int saida);
+
+/** Arquivo de amostras aberto com mmap, as amostras são lidas direto das páginas do arquivo.
+* Várias threads podem ler ao mesmo tempo, ex: dentro de uma FuncaoAptidao.
+*/
+class ConjuntoMapeado {
+private:
+    void* mapa;
+    std::size_t tamanho;
+    const double* dados;
+    std::size_t numAmostras;
+    int entrada;
+    int saida;
+    std::string erro;
+
+    /** Função que registra o erro, fecha o mapeamento e retorna false */
+    bool falhar(const std::string& mensagem);
+public:
+    ConjuntoMapeado();
+    ~ConjuntoMapeado();
+
+    ConjuntoMapeado(const ConjuntoMapeado&) = delete;
+    ConjuntoMapeado& operator=(const ConjuntoMapeado&) = delete;
+
+    /** Função que mapeia o arquivo e valida o cabeçalho. Retorna false se ele não existir, for de outra versão,
+    * de outra ordem de bytes ou estiver truncado (veja getErro())
+    */
+    bool abrir(const std::string& caminho);
+
+    /** Função que desfaz o mapeamento, invalidando os ponteiros de getInputs() e getAlvos() */
+    void fechar();
+
+    /** Função que avisa o sistema que as amostras [inicio, inicio + quantidade) vão ser lidas em breve */
+    void preCarregar(std::size_t inicio, std::size_t quantidade) const;
+
+    /** Função que retorna os inputs da amostra indice */
+    const double* getInputs(std::size_t indice) const {
+        return dados + indice * (entrada + saida);
+    }
+
+    /** Função que retorna os alvos da amostra indice */
+    const double* getAlvos(std::size_t indice) const {
+        return dados + indice * (entrada + saida) + entrada;
+    }
+
+    std::size_t getNumAmostras() const { return numAmostras; }
+    int getEntrada() const { return entrada; }
+    int getSaida() const { return saida; }
+
+    /** Função que retorna a mensagem do último erro de abrir() */
+    const std::string& getErro() const {
+        return erro;
+    }
+};
+
+/** Fonte sequencial de amostras usada pelo FluxoLotes. ler() é sempre chamada da thread de leitura do fluxo */
+class LeitorAmostras {
+public:
+    virtual ~LeitorAmostras() {}
+
+    /** Função que copia até maximo amostras para inputs (maximo x entrada) e alvos (maximo x saida).
+    * Retorna quantas amostras leu, 0 no fim dos dados ou em caso de erro (veja getErro())
+    */
+    virtual int ler(double* inputs, double* alvos, int maximo) = 0;
+
+    /** Função que volta para a primeira amostra. Retorna false se não conseguir */
+    virtual bool reiniciar() = 0;
+
+    virtual int getEntrada() const = 0;
+    virtual int getSaida() const = 0;
+
+    /** Função que retorna a mensagem do último erro, vazia se não houve erro */
+    virtual const std::string& getErro() const = 0;
+};
+
+/** Leitor de um arquivo binário de amostras mapeado, pede ao sistema as páginas do próximo lote antes de copiar */
+class LeitorMapeado : public LeitorAmostras {
+private:
+    ConjuntoMapeado conjunto;
+    std::size_t posicao;
+    std::string erro;
+public:
+    LeitorMapeado();
+
+    /** Função que abre o arquivo. Retorna false se ConjuntoMapeado::abrir() falhar */
+    bool abrir(const std::string& caminho);
+
+    int ler(double* inputs, double* alvos, int maximo) override;
+    bool reiniciar() override;
+    int getEntrada() const override { return conjunto.getEntrada(); }
+    int getSaida() const override { return conjunto.getSaida(); }
+    const std::string& getErro() const override { return erro; }
+};
+
+/** Leitor de CSV em fluxo: lê o arquivo linha a linha, sem carregar tudo, e converte uma linha por amostra.
+* Cada linha tem entrada inputs seguidos de saida alvos separados por vírgula; linhas vazias são ignoradas e
+* a primeira linha não vazia é pulada se não começar com um número (cabeçalho). Uma linha com outro número de colunas é erro.
+*/
+class LeitorCsv : public LeitorAmostras {
+private:
+    std::ifstream arquivo;
+    std::string caminho;
+    std::string linha;       // reaproveitada entre linhas, só realoca quando aparece uma linha maior
+    std::size_t numLinha;
+    bool procurarCabecalho;  // true até a primeira linha não vazia, a única que pode ser cabeçalho
+    int entrada;
+    int saida;
+    std::string erro;
+
+    /** Função que converte a linha atual em entrada + saida valores. Retorna false se ela não tiver esse número de colunas */
+    bool converterLinha(double* inputs, double* alvos);
+public:
+    /** Cria o leitor
+    * @param entrada - colunas de inputs em cada linha
+    * @param saida - colunas de alvos depois dos inputs, 0 se não houver
+    */
+    LeitorCsv(int entrada, int saida);
+
+    /** Função que abre o arquivo. Retorna false se ele não existir */
+    bool abrir(const std::string& caminho);
+
+    int ler(double* inputs, double* alvos, int maximo) override;
+    bool reiniciar() override;
+    int getEntrada() const override { return entrada; }
+    int getSaida() const override { return saida; }
+    const std::string& getErro() const override { return erro; }
+};
+
+/** Lote produzido pelo FluxoLotes. inputs (amostras x entrada) e alvos (amostras x saida) são row-major e começam
+* em um endereço alinhado, prontos para iniciarLote() e Treinador::treinarLote()
+*/
+struct LoteAmostras {
+    VetorAlinhado inputs;
+    VetorAlinhado alvos;
+    int amostras = 0;
+    int entrada = 0;
+    int saida = 0;
+    std::size_t primeira = 0;   // índice da primeira amostra do lote no conjunto
+
+    const double* getInputs(int amostra) const { return inputs.data() + static_cast<std::size_t>(amostra) * entrada; }
+    const double* getAlvos(int amostra) const { return alvos.data() + static_cast<std::size_t>(amostra) * saida; }
+};
+
+/** Fila limitada de lotes preenchida por uma thread de leitura. Os buffers dos lotes são alocados uma vez e reciclados:
+* enquanto quem consome calcula sobre um lote, a thread de leitura já lê e converte o(s) próximo(s) nos outros buffers.
+* Com profundidade 2 é um buffer duplo; a leitura só para quando todos os buffers estão cheios esperando consumo.
+* Só uma thread deve chamar proximo() e reiniciar().
+*/
+class FluxoLotes {
+private:
+    std::unique_ptr<LeitorAmostras> leitor;
+    std::vector<LoteAmostras> lotes;
+    int tamanhoLote;
+    std::deque<int> prontos;        // índices de lotes cheios, na ordem de leitura
+    std::vector<int> livres;        // índices de lotes que a thread de leitura pode preencher
+    int emUso;                      // lote devolvido pelo último proximo(), -1 se nenhum
+    std::size_t lidas;              // amostras lidas desde o último reiniciar()
+    bool fim;
+    bool parar;
+    std::mutex trava;
+    std::condition_variable temPronto;
+    std::condition_variable temLivre;
+    std::thread leitura;
+
+    /** Função executada pela thread de leitura */
+    void ler();
+
+    /** Função que para a thread de leitura e espera ela sair */
+    void pararLeitura();
+
+    /** Função que esvazia a fila e inicia a thread de leitura do começo dos dados */
+    void iniciarLeitura();
+public:
+    /** Cria o fluxo e já começa a ler
+    * @param leitor - fonte das amostras, já aberta
+    * @param tamanhoLote - amostras por lote, o último lote pode ter menos
+    * @param profundidade - número de buffers de lote, no mínimo 2
+    */
+    FluxoLotes(std::unique_ptr<LeitorAmostras> leitor, int tamanhoLote, int profundidade = 2);
+    ~FluxoLotes();
+
+    FluxoLotes(const FluxoLotes&) = delete;
+    FluxoLotes& operator=(const FluxoLotes&) = delete;
+
+    /** Função que devolve o lote anterior para a leitura e retorna o próximo lote, esperando se ele ainda não estiver pronto.
+    * Retorna nullptr no fim dos dados ou depois de um erro do leitor (veja getErro()). O ponteiro vale até a próxima chamada
+    */
+    const LoteAmostras* proximo();
+
+    /** Função que volta para a primeira amostra, para uma nova época. Retorna false se o leitor não conseguir voltar */
+    bool reiniciar();
+
+    int getEntrada() const { return leitor->getEntrada(); }
+    int getSaida() const { return leitor->getSaida(); }
+
+    /** Função que retorna o erro do leitor, vazio se não houve erro. Só deve ser chamada depois de proximo() retornar nullptr */
+    const std::string& getErro() const { return leitor->getErro(); }
+};
+
+/** Função que pontua a saída de uma rede em uma amostra, o retorno é somado na aptidão da rede.
+* avaliarConjunto() chama a mesma função ao mesmo tempo de todas as threads do pool, então ela deve ser thread-safe:
+* sem estado ou com a própria sincronização
+* @param valores - valores brutos da camada de saída
+* @param alvos - alvos da amostra, sem significado se o fluxo não tiver alvos
+*/
+typedef std::function<double(const double* valores, const double* alvos, int saida)> FuncaoPontuacao;
+
+/** Função que avalia todas as redes em todos os lotes do fluxo, do ponto em que ele está até o fim.
+* Cada lote é calculado com iniciarLote() por todas as redes, divididas entre as threads do pool, enquanto a thread
+* de leitura do fluxo já prepara o próximo. aptidoes[r] recebe a soma de pontuar() em todas as amostras.
+* Em cada lote a rede r é calculada por uma única thread, por isso aptidoes[r] é somado sem trava; pontuar é chamada
+* em paralelo e deve ser thread-safe.
+* Retorna false se alguma rede não tiver a entrada do fluxo (ou a saída, quando o fluxo tem alvos) ou se o leitor falhar
+*/
+bool avaliarConjunto(const std::vector<const RedeNeural*>& redes, FluxoLotes& fluxo, const FuncaoPontuacao& pontuar,
+                     PoolTrabalho& pool, std::vector<double>& aptidoes);
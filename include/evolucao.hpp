@@ -0,0 +1,75 @@
+#pragma once
+#include <vector>
+#include <functional>
+#include <memory>
+#include "redeNeural.hpp"
+#include "poolTrabalho.hpp"
+
+/** Função de aptidão do usuário: recebe um indivíduo e a área de trabalho da thread que está avaliando, retorna a aptidão (maior é melhor).
+* É chamada por várias threads ao mesmo tempo, então deve usar a versão const de iniciar() com a área recebida.
+*/
+typedef std::function<double(const RedeNeural& rede, AreaTrabalho& area)> FuncaoAptidao;
+
+/** Configuração do treinamento por neuroevolução */
+struct ConfiguracaoEvolucao {
+    int tamanhoPopulacao = 100;
+    int numElite = 10;            // melhores indivíduos que passam intactos para a próxima geração e servem de pais
+    bool usarTruncamento = true;  // adiciona um filho com a média dos pesos da elite (truncamento)
+    bool truncamentoPonderado = false;  // média da elite ponderada pela aptidão, só vale se as aptidões forem >= 0
+    double valorMutacao = 0.1;    // valor passado para modificarPesos() nos filhos
+    double taxaMutacao = 0.5;     // chance de cada peso de um filho ser alterado
+    uint64_t semente = 0;         // com a mesma semente o treinamento dá sempre o mesmo resultado; 0 sorteia uma semente
+    int numThreads = 0;           // 0 usa std::thread::hardware_concurrency()
+};
+
+/** Estatísticas de uma geração */
+struct EstatisticasGeracao {
+    int geracao;
+    double melhorAptidao;
+    double mediaAptidao;
+    double segundosAvaliacao;       // tempo gasto avaliando a população
+    double segundosReproducao;      // tempo gasto com seleção, truncamento e mutação
+    double individuosPorSegundo;    // vazão da avaliação
+};
+
+/** Treinador de população: avalia os indivíduos em paralelo em um pool com roubo de trabalho,
+* seleciona a elite, recombina com truncamento() e muta com modificarPesos()
+*/
+class Neuroevolucao {
+private:
+    ConfiguracaoEvolucao config;
+    FuncaoAptidao aptidao;
+    std::unique_ptr<PoolTrabalho> pool;
+    std::vector<RedeNeural> populacao;
+    std::vector<RedeNeural> proxima;   // próxima geração, trocada com populacao no fim de cada geração
+    std::vector<double> aptidoes;
+    std::vector<AreaTrabalho> areas;   // uma por thread do pool
+    uint64_t semente;
+    Xoshiro256 gerador;                // sorteio dos pais, as mutações usam um gerador derivado por indivíduo
+    int geracao;
+    int indiceMelhor;
+
+    /** Função que avalia toda a população em paralelo e preenche aptidoes */
+    void avaliar();
+public:
+    /** Cria a população inicial com pesos aleatórios
+    * @param entrada, numLayers, saida - topologia dos indivíduos, igual ao construtor de RedeNeural
+    */
+    Neuroevolucao(int entrada, int numLayers, int saida, const ConfiguracaoEvolucao& config, FuncaoAptidao aptidao);
+
+    /** Função que avalia a geração atual e cria a próxima a partir dela. Retorna as estatísticas da geração avaliada */
+    EstatisticasGeracao proximaGeracao();
+
+    /** Função que roda várias gerações seguidas, retorna as estatísticas de cada uma */
+    std::vector<EstatisticasGeracao> evoluir(int geracoes);
+
+    /** Função que retorna o melhor indivíduo da última geração avaliada */
+    const RedeNeural& getMelhor() const {
+        return populacao[indiceMelhor];
+    }
+
+    /** Função que retorna a população atual */
+    const std::vector<RedeNeural>& getPopulacao() const {
+        return populacao;
+    }
+};
@@ -0,0 +1,123 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/** Instrumentação opcional da biblioteca, ligada em tempo de compilação com REDENEURAL_INSTRUMENTACAO
+* (opção do CMake de mesmo nome). Desligada, as macros REDENEURAL_* não geram código nenhum (só REDENEURAL_CONTAR_ALOCACAO,
+* que continua chamando o gancho de alocação, veja definirGanchoAlocacao()) e o retrato sai vazio.
+* Ligada, cada thread grava em contadores próprios (sem trava nem operação atômica de leitura-escrita no caminho quente)
+* e retratoInstrumentacao() junta tudo. O tempo de cada camada usa uma leitura do relógio por fronteira entre camadas.
+*/
+
+/** Operações contadas e cronometradas */
+enum OperacaoInstrumentada {
+    OPERACAO_INICIAR = 0,        // iniciar() por amostra, RedeNeural e VisaoRede
+    OPERACAO_INICIAR_LOTE,
+    OPERACAO_MODIFICAR_PESOS,
+    OPERACAO_TRUNCAMENTO,
+    OPERACAO_GERAR_PESOS,
+    NUM_OPERACOES
+};
+
+/** Camadas com histograma próprio, as mais profundas entram na última */
+constexpr int MAX_CAMADAS_INSTRUMENTADAS = 16;
+
+/** Faixas dos histogramas: a faixa k conta durações abaixo de 2^(k+6) ns (64 ns, 128 ns, ...), a última não tem limite */
+constexpr int NUM_FAIXAS_HISTOGRAMA = 24;
+
+/** Histograma de durações em faixas exponenciais */
+struct Histograma {
+    uint64_t contagens[NUM_FAIXAS_HISTOGRAMA] = {0};
+    uint64_t quantidade = 0;
+    uint64_t somaNs = 0;
+
+    /** Função que retorna o limite superior da faixa em segundos, infinito na última */
+    static double limiteSegundos(int faixa);
+};
+
+/** Contadores de uma thread (ou a soma de todas) */
+struct EstatisticasThread {
+    int thread = -1;   // ordem em que a thread usou a biblioteca pela primeira vez, -1 na soma
+    uint64_t chamadas[NUM_OPERACOES] = {0};
+    Histograma tempos[NUM_OPERACOES];
+    Histograma camadas[MAX_CAMADAS_INSTRUMENTADAS];   // tempo de cada camada no forward por amostra
+    uint64_t alocacoes = 0;                           // blocos alinhados: parâmetros, ativações, áreas de trabalho
+    uint64_t bytesAlocados = 0;
+};
+
+/** Cópia dos contadores de todas as threads em um instante */
+struct RetratoInstrumentacao {
+    bool ativa = false;   // false se a biblioteca foi compilada sem REDENEURAL_INSTRUMENTACAO
+    std::vector<EstatisticasThread> threads;
+
+    /** Função que soma os contadores de todas as threads */
+    EstatisticasThread total() const;
+};
+
+/** Função que retorna o nome de uma operação, usado no texto exportado */
+const char* nomeOperacao(int operacao);
+
+/** Função que copia os contadores de todas as threads, pode ser chamada a qualquer momento de qualquer thread */
+RetratoInstrumentacao retratoInstrumentacao();
+
+/** Função que escreve o retrato no formato texto do Prometheus: contadores por thread e histogramas somados */
+std::string exportarPrometheus(const RetratoInstrumentacao& retrato);
+
+/** Função igual a exportarPrometheus(retratoInstrumentacao()) */
+std::string exportarPrometheus();
+
+/** Função que zera os contadores de todas as threads */
+void zerarInstrumentacao();
+
+/** Funções de registro usadas pelas macros, cada uma grava nos contadores da thread que chama */
+void registrarChamada(int operacao, uint64_t duracaoNs);
+void registrarCamada(int camada, uint64_t duracaoNs);
+void registrarAlocacao(std::size_t bytes);
+
+/** Função chamada com o tamanho em bytes de cada bloco alinhado que a biblioteca aloca (AlocadorAlinhado e ArenaPesos) */
+typedef void (*GanchoAlocacao)(std::size_t bytes);
+
+/** Função que instala o gancho de alocação para todas as threads e retorna o anterior; nullptr desinstala.
+* Funciona com ou sem REDENEURAL_INSTRUMENTACAO, para quem mede alocações de fora da biblioteca (ex: bench_rede).
+* O gancho pode ser chamado de várias threads ao mesmo tempo
+*/
+GanchoAlocacao definirGanchoAlocacao(GanchoAlocacao gancho);
+
+/** Função usada por REDENEURAL_CONTAR_ALOCACAO, chama o gancho instalado se houver */
+void avisarAlocacao(std::size_t bytes);
+
+/** Função que retorna o relógio monotônico em ns */
+uint64_t relogioNs();
+
+/** Cronômetro de escopo: registra a chamada e o tempo entre a criação e a destruição */
+class MedidorTempo {
+private:
+    int operacao;
+    uint64_t inicio;
+public:
+    explicit MedidorTempo(int operacao) : operacao(operacao), inicio(relogioNs()) {}
+    ~MedidorTempo() {
+        registrarChamada(operacao, relogioNs() - inicio);
+    }
+};
+
+#ifdef REDENEURAL_INSTRUMENTACAO
+#define REDENEURAL_MEDIR(operacao) MedidorTempo medidorOperacao(operacao)
+#define REDENEURAL_INICIAR_CAMADAS() uint64_t marcaCamada = relogioNs()
+#define REDENEURAL_FIM_CAMADA(indice) do { \
+        uint64_t agoraCamada = relogioNs(); \
+        registrarCamada((indice), agoraCamada - marcaCamada); \
+        marcaCamada = agoraCamada; \
+    } while(0)
+#define REDENEURAL_CONTAR_ALOCACAO(bytes) do { \
+        registrarAlocacao(bytes); \
+        avisarAlocacao(bytes); \
+    } while(0)
+#else
+#define REDENEURAL_MEDIR(operacao) ((void)0)
+#define REDENEURAL_INICIAR_CAMADAS() ((void)0)
+#define REDENEURAL_FIM_CAMADA(indice) ((void)0)
+#define REDENEURAL_CONTAR_ALOCACAO(bytes) avisarAlocacao(bytes)
+#endif
@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+
+/** Conjunto de kernels do caminho quente da rede. A versão usada é escolhida uma vez, na carga da biblioteca,
+* a partir das instruções que a CPU suporta (cpuid), então o mesmo libredeneural.so roda em máquinas antigas e novas.
+* Todos os kernels esperam ponteiros alinhados em ALINHAMENTO e tamanhos (n, stride) múltiplos de LARGURA_SIMD.
+*/
+struct Kernels {
+    const char* nome;
+
+    /** Função que retorna o produto escalar de a e b com n elementos */
+    double (*produtoEscalar)(const double* a, const double* b, int n);
+
+    /** Função que calcula uma camada densa: saida[j] = bias[j] + pesos[j] . entrada, com ReLU fundido quando relu é true
+    * @param pesos - matriz neuronios x stride em row-major
+    */
+    void (*camada)(const double* pesos, const double* bias, const double* entrada, double* saida,
+                   int neuronios, int stride, bool relu);
+
+    /** Função que acumula em c o bloco 4 amostras x 4 neurônios do produto em lote, c[i][j] += a[i][k0..k1) . w[j][k0..k1)
+    * Usada por iniciarLote(), cada peso carregado é reaproveitado nas 4 amostras
+    */
+    void (*bloco4x4)(const double* a, int strideA, const double* w, int strideW,
+                     double* c, int strideC, int k0, int k1);
+
+    /** Função que retorna o produto escalar de dois vetores float, n múltiplo de 16 (uma linha de cache). Usada por RedeReduzida<float> */
+    float (*produtoEscalarFloat)(const float* a, const float* b, int n);
+
+    /** Função que retorna o produto escalar de dois vetores int8 acumulado em int32, n múltiplo de 64 e valores em [-127, 127].
+    * Usada por RedeReduzida<int8_t>
+    */
+    int32_t (*produtoEscalarInt8)(const int8_t* a, const int8_t* b, int n);
+
+    /** Função que calcula uma camada esparsa em CSR: saida[j] = bias[j] + soma de valores[k] * entrada[colunas[k]] para k em
+    * [linhas[j], linhas[j + 1]), com ReLU fundido quando relu é true. Usada por RedePodada.
+    * Cada linha tem um múltiplo de LARGURA_SIMD elementos (o preenchimento tem valor 0 e coluna 0), então a entrada é juntada com gather sem resto
+    */
+    void (*camadaEsparsa)(const double* valores, const int32_t* colunas, const uint32_t* linhas, const double* bias,
+                          const double* entrada, double* saida, int neuronios, bool relu);
+
+    /** Função que converte os valores da camada de saída em booleanos (valor > 0), n pode ser qualquer tamanho */
+    void (*limiar)(const double* valores, bool* saidas, int n);
+};
+
+/** Função que retorna os kernels escolhidos para a CPU atual.
+* A variável de ambiente REDENEURAL_KERNEL (escalar, sse2, avx2, avx512) força uma versão, se a CPU suportar.
+*/
+const Kernels& kernelsAtivos();
+
+/** Função que retorna a versão escalar portátil, usada como referência e em CPUs sem SIMD */
+const Kernels& kernelsEscalar();
+
+/** Função que retorna todas as versões que a CPU atual consegue executar, da escalar até a mais larga */
+std::vector<const Kernels*> kernelsDisponiveis();
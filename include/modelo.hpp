@@ -0,0 +1,84 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "redeNeural.hpp"
+
+/** Formato binário de modelo, versão 1. Todos os campos ficam na ordem de bytes da máquina que gravou, marcada em marcaEndian:
+*   cabeçalho (64 bytes) | diretório (uma EntradaModelo por rede) | larguras de cada rede (uint32) | blocos de parâmetros
+* Cada bloco de parâmetros começa em um offset múltiplo de ALINHAMENTO e tem exatamente o layout de calcularCamadas(),
+* então depois do mmap os pesos são usados direto das páginas mapeadas, sem cópia.
+*/
+constexpr uint32_t VERSAO_MODELO = 1;
+constexpr uint32_t MARCA_ENDIAN = 0x01020304;
+
+struct CabecalhoModelo {
+    char magica[8];           // "REDENEUR"
+    uint32_t versao;          // VERSAO_MODELO
+    uint32_t marcaEndian;     // MARCA_ENDIAN na ordem de bytes de quem gravou
+    uint32_t larguraSimd;     // LARGURA_SIMD usado no preenchimento das linhas
+    uint32_t bytesValor;      // sizeof(double)
+    uint64_t numRedes;
+    uint64_t tamanhoArquivo;
+    uint8_t reservado[24];
+};
+
+struct EntradaModelo {
+    uint64_t offsetLarguras;    // onde começam as larguras da rede (entrada, ocultos, saída)
+    uint64_t offsetParametros;  // onde começa o bloco de parâmetros, múltiplo de ALINHAMENTO
+    uint64_t numParametros;     // tamanho do bloco de parâmetros, em doubles
+    uint32_t numLarguras;
+    uint32_t reservado;
+};
+
+/** Função que grava várias redes (ex: uma população inteira ou um ensemble) em um arquivo só. Retorna false se não conseguir gravar */
+bool salvarModelo(const std::string& caminho, const std::vector<const RedeNeural*>& redes);
+
+/** Função que grava uma rede em um arquivo. Retorna false se não conseguir gravar */
+bool salvarModelo(const std::string& caminho, const RedeNeural& rede);
+
+/** Modelo aberto com mmap: as redes são visões direto das páginas do arquivo, sem copiar os pesos.
+* As visões (e qualquer cópia delas) só valem enquanto o ModeloMapeado estiver aberto.
+*/
+class ModeloMapeado {
+private:
+    void* mapa;
+    std::size_t tamanho;
+    std::vector<VisaoRede> redes;
+    std::string erro;
+
+    /** Função que registra o erro, fecha o mapeamento e retorna false */
+    bool falhar(const std::string& mensagem);
+public:
+    ModeloMapeado();
+    ~ModeloMapeado();
+
+    ModeloMapeado(const ModeloMapeado&) = delete;
+    ModeloMapeado& operator=(const ModeloMapeado&) = delete;
+
+    /** Função que mapeia o arquivo e valida o cabeçalho, o diretório e cada rede.
+    * Retorna false se o arquivo não existir, for de outra versão, de outra ordem de bytes ou estiver corrompido (veja getErro())
+    */
+    bool abrir(const std::string& caminho);
+
+    /** Função que desfaz o mapeamento, invalidando as visões */
+    void fechar();
+
+    /** Função que retorna o número de redes no arquivo */
+    std::size_t getNumRedes() const {
+        return redes.size();
+    }
+
+    /** Função que retorna a visão da rede indice */
+    const VisaoRede& getRede(std::size_t indice) const {
+        return redes[indice];
+    }
+
+    /** Função que retorna a mensagem do último erro de abrir() */
+    const std::string& getErro() const {
+        return erro;
+    }
+};
+
+/** Função que lê a rede indice de um arquivo de modelo e copia para rede. Retorna false se o arquivo for inválido */
+bool carregarModelo(const std::string& caminho, RedeNeural& rede, std::size_t indice = 0);
@@ -0,0 +1,67 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+/** Pool de threads persistente com roubo de trabalho (work-stealing).
+* paraCada() divide os índices em uma faixa por thread; quando uma thread termina a sua, ela rouba metade do que
+* sobrou na faixa de outra. Assim tarefas com custo muito diferente (ex: aptidão de indivíduos) não deixam threads paradas.
+*/
+class PoolTrabalho {
+private:
+    // Faixa de índices ainda não executados de uma thread, com preenchimento para não dividir linha de cache com a vizinha
+    struct Faixa {
+        std::mutex trava;
+        int inicio = 0;
+        int fim = 0;
+        char preenchimento[64];
+    };
+
+    std::vector<std::thread> threads;
+    std::vector<Faixa> faixas;
+    int numThreads;
+
+    std::mutex trava;
+    std::condition_variable acordar;
+    std::condition_variable terminou;
+    const std::function<void(int, int)>* tarefaAtual = nullptr;
+    unsigned long geracao = 0;      // incrementado a cada paraCada(), acorda as threads
+    int threadsAtivas = 0;          // threads de fundo que ainda estão na rodada atual
+    bool encerrar = false;
+    std::exception_ptr erro;
+
+    /** Função executada por cada thread de fundo */
+    void laco(int indiceThread);
+
+    /** Função que executa os índices da própria faixa e depois rouba das outras até não sobrar nada */
+    void trabalhar(int indiceThread, const std::function<void(int, int)>& tarefa);
+
+    /** Função que pega o próximo índice da faixa da thread, retorna false se a faixa estiver vazia */
+    bool pegar(int indiceThread, int& indice);
+
+    /** Função que rouba metade da faixa de outra thread para a faixa de indiceThread, retorna false se todas estiverem vazias */
+    bool roubar(int indiceThread);
+public:
+    /** Cria o pool
+    * @param numThreads - número de threads, contando a que chama paraCada(); 0 usa std::thread::hardware_concurrency()
+    */
+    explicit PoolTrabalho(int numThreads = 0);
+    ~PoolTrabalho();
+
+    PoolTrabalho(const PoolTrabalho&) = delete;
+    PoolTrabalho& operator=(const PoolTrabalho&) = delete;
+
+    /** Função que executa tarefa(indice, thread) para todo indice em [0, quantidade), em paralelo, e só retorna quando todos terminarem.
+    * thread é o número da thread que executou (0 é a thread que chamou), útil para indexar dados por thread.
+    * Se alguma tarefa lançar uma exceção, a primeira é relançada aqui depois que a rodada termina.
+    */
+    void paraCada(int quantidade, const std::function<void(int, int)>& tarefa);
+
+    /** Função que retorna o número de threads do pool, contando a que chama paraCada() */
+    int getNumThreads() const {
+        return numThreads;
+    }
+};
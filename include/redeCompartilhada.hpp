@@ -0,0 +1,100 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "redeNeural.hpp"
+
+/** Arena de blocos de parâmetros: reserva páginas grandes alinhadas e corta os blocos delas, e um bloco liberado
+* volta para uma lista do seu tamanho em vez de ir para o sistema. Numa população todos os blocos têm o mesmo tamanho,
+* então depois das primeiras gerações nenhuma alocação chega ao malloc.
+* Cópias de ArenaPesos apontam para a mesma arena, que só é desfeita quando a última cópia e o último bloco somem.
+*/
+class ArenaPesos {
+private:
+    struct Estado;
+    std::shared_ptr<Estado> estado;
+public:
+    /** Cria a arena
+    * @param doublesPorPagina - tamanho mínimo de cada página reservada, blocos maiores ganham uma página só deles
+    */
+    explicit ArenaPesos(std::size_t doublesPorPagina = 1 << 20);
+
+    /** Função que retorna um bloco alinhado de quantidade doubles, devolvido à arena quando o último shared_ptr sumir */
+    std::shared_ptr<double> alocar(std::size_t quantidade);
+
+    /** Função que retorna quantos bytes a arena já reservou do sistema */
+    std::size_t getBytesReservados() const;
+
+    /** Função que retorna quantos blocos estão em uso */
+    std::size_t getBlocosEmUso() const;
+};
+
+/** Topologia compartilhada por todas as redes de uma população */
+struct TopologiaCompartilhada {
+    std::vector<int> larguras;
+    std::vector<CamadaDensa> camadas;
+    std::size_t numParametros;
+    std::size_t larguraAtivacao;
+};
+
+/** Rede que compartilha o bloco de parâmetros com as outras (copy-on-write) e guarda só as diferenças esparsas dela.
+* Copiar uma RedeCompartilhada não copia pesos: as duas apontam para o mesmo bloco base. mutar() sorteia os pesos
+* como modificarPesos() e grava apenas (índice, diferença) em relação à base, ordenados por índice.
+* iniciar() não precisa materializar: cada camada é calculada com os pesos da base e as diferenças são somadas
+* à saída dela antes do ReLU. Quando as diferenças passam de 1/LIMITE_DELTA dos parâmetros, a correção esparsa
+* deixa de compensar e a rede ganha um bloco próprio da arena com tudo aplicado.
+*/
+class RedeCompartilhada {
+private:
+    std::shared_ptr<const TopologiaCompartilhada> topologia;
+    std::shared_ptr<const double> base;
+    std::vector<uint32_t> indicesDelta;      // posições no bloco de parâmetros, crescentes
+    std::vector<double> diferencasDelta;     // peso atual - peso da base em cada posição
+    ArenaPesos arena;
+
+    /** Função que retorna o peso atual numa posição do bloco */
+    double pesoAtual(std::size_t indice) const;
+public:
+    /** Diferenças acima de numParametros / LIMITE_DELTA fazem mutar() materializar a rede */
+    static constexpr std::size_t LIMITE_DELTA = 16;
+
+    /** Cria a rede copiando os pesos de uma RedeNeural para um bloco da arena, uma vez só */
+    RedeCompartilhada(const RedeNeural& rede, const ArenaPesos& arena);
+
+    /** Função igual a RedeNeural::modificarPesos(valor, taxa, gerador): com o mesmo estado do gerador altera os mesmos pesos
+    * da mesma forma, mas guarda só as diferenças. A base não é alterada, outras redes que a compartilham não veem nada
+    */
+    void mutar(double valor, double taxa, Xoshiro256& gerador);
+
+    /** Função que cria um bloco próprio na arena com a base e as diferenças aplicadas, e zera as diferenças */
+    void materializar();
+
+    /** Função igual à RedeNeural::iniciar() const, com a correção esparsa das diferenças em cada camada */
+    bool iniciar(const double* inputs, std::size_t quantidade, bool* saidas, AreaTrabalho& area,
+                 double* valores = nullptr) const;
+
+    /** Função que retorna uma área de trabalho dimensionada para esta rede */
+    AreaTrabalho criarAreaTrabalho() const;
+
+    /** Função que escreve os pesos atuais em uma RedeNeural, trocando a topologia dela se precisar */
+    void copiarPara(RedeNeural& destino) const;
+
+    /** Função que retorna true se as duas redes usam o mesmo bloco base */
+    bool compartilhaBase(const RedeCompartilhada& outra) const {
+        return base == outra.base;
+    }
+
+    /** Função que retorna quantas diferenças a rede guarda */
+    std::size_t getNumDeltas() const {
+        return indicesDelta.size();
+    }
+
+    /** Função que retorna a memória própria da rede (as diferenças), sem contar a base compartilhada */
+    std::size_t getBytesProprios() const {
+        return indicesDelta.capacity() * sizeof(uint32_t) + diferencasDelta.capacity() * sizeof(double);
+    }
+
+    int getEntrada() const { return topologia->larguras.front(); }
+    int getSaida() const { return topologia->larguras.back(); }
+    const std::vector<CamadaDensa>& getCamadas() const { return topologia->camadas; }
+};
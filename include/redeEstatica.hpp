@@ -0,0 +1,157 @@
+#pragma once
+#include <array>
+#include <algorithm>
+#include "redeNeural.hpp"
+
+/** Arredonda n para cima até o próximo múltiplo de LARGURA_SIMD, em tempo de compilação */
+constexpr int arredondarSimdEstatico(int n) {
+    return (n + LARGURA_SIMD - 1) / LARGURA_SIMD * LARGURA_SIMD;
+}
+
+/** Rede com a topologia fixa em tempo de compilação: Entrada neurônios de entrada, NumLayers layers ocultos com Entrada
+* neurônios cada (como RedeNeural(entrada, numLayers, saida)) e Saida neurônios de saída.
+* Os parâmetros ficam em um std::array dentro do objeto, no mesmo layout do bloco contíguo da RedeNeural, então a conversão
+* entre as duas é uma cópia direta. Todos os tamanhos são constantes, o compilador desenrola os loops de cada camada,
+* e iniciar() usa buffers na pilha: é const, não aloca nada e não precisa de área de trabalho.
+* O alinhamento de 64 bytes só é garantido para objetos na pilha ou estáticos; alocados com new (C++11) continuam corretos, só um pouco mais lentos.
+*/
+template<int Entrada, int NumLayers, int Saida>
+class RedeNeuralEstatica {
+    static_assert(Entrada > 0 && NumLayers >= 0 && Saida > 0, "topologia inválida");
+public:
+    /** Entradas arredondadas para LARGURA_SIMD, stride de todas as matrizes de pesos (todas as camadas recebem Entrada valores) */
+    static constexpr int STRIDE = arredondarSimdEstatico(Entrada);
+
+    /** Tamanho de uma camada oculta e da camada de saída no bloco de parâmetros: matriz de pesos seguida do bias */
+    static constexpr std::size_t TAMANHO_OCULTA = static_cast<std::size_t>(Entrada) * STRIDE + arredondarSimdEstatico(Entrada);
+    static constexpr std::size_t TAMANHO_SAIDA = static_cast<std::size_t>(Saida) * STRIDE + arredondarSimdEstatico(Saida);
+
+    /** Tamanho do bloco de parâmetros, igual a RedeNeural::getNumParametros() da mesma topologia */
+    static constexpr std::size_t NUM_PARAMETROS = NumLayers * TAMANHO_OCULTA + TAMANHO_SAIDA;
+
+    /** Tamanho de cada buffer de ativação */
+    static constexpr int LARGURA_ATIVACAO = STRIDE > arredondarSimdEstatico(Saida) ? STRIDE : arredondarSimdEstatico(Saida);
+
+private:
+    alignas(ALINHAMENTO) std::array<double, NUM_PARAMETROS> parametros;
+
+    /** Função que calcula uma camada com Neuronios neurônios sobre Entrada valores.
+    * Cada linha é somada em 4 acumuladores independentes (STRIDE é múltiplo de LARGURA_SIMD), assim a cadeia de somas
+    * dependentes de cada neurônio fica 4x mais curta; em redes pequenas essa latência é quase todo o custo
+    */
+    template<int Neuronios, bool Relu>
+    static void propagarCamada(const double* pesos, const double* bias, const double* entrada, double* saida) {
+        for(int n = 0; n < Neuronios; n++) {
+            const double* linha = pesos + static_cast<std::size_t>(n) * STRIDE;
+            double soma0 = 0, soma1 = 0, soma2 = 0, soma3 = 0;
+            for(int p = 0; p < STRIDE; p += 4) {
+                soma0 += linha[p] * entrada[p];
+                soma1 += linha[p + 1] * entrada[p + 1];
+                soma2 += linha[p + 2] * entrada[p + 2];
+                soma3 += linha[p + 3] * entrada[p + 3];
+            }
+            double soma = bias[n] + ((soma0 + soma1) + (soma2 + soma3));
+            saida[n] = (Relu && soma < 0) ? 0 : soma;
+        }
+    }
+
+public:
+    /** Cria a rede com todos os pesos zerados */
+    RedeNeuralEstatica() {
+        parametros.fill(0.0);
+    }
+
+    /** Cria a rede com pesos gerados a partir de uma semente, os mesmos de RedeNeural(Entrada, NumLayers, Saida, semente) */
+    explicit RedeNeuralEstatica(uint64_t semente) {
+        setRede(RedeNeural(Entrada, NumLayers, Saida, semente));
+    }
+
+    /** Função que inicia os calculos da rede, sem alocar nada e sem alterar a rede
+    * @param inputs - Entrada valores de entrada
+    * @param saidas - buffer com espaço para Saida booleanos
+    * @param valores - buffer opcional com espaço para Saida doubles, recebe os valores brutos da camada de saída
+    */
+    void iniciar(const double* inputs, bool* saidas, double* valores = nullptr) const {
+        // Preenchimento zerado uma vez, as camadas só escrevem nos primeiros neurônios de cada buffer
+        alignas(ALINHAMENTO) double atual[LARGURA_ATIVACAO] = {0};
+        alignas(ALINHAMENTO) double proximo[LARGURA_ATIVACAO] = {0};
+        std::copy(inputs, inputs + Entrada, atual);
+
+        const double* bloco = parametros.data();
+        double* a = atual;
+        double* b = proximo;
+        for(int l = 0; l < NumLayers; l++) {
+            propagarCamada<Entrada, true>(bloco, bloco + static_cast<std::size_t>(Entrada) * STRIDE, a, b);
+            bloco += TAMANHO_OCULTA;
+            std::swap(a, b);
+        }
+        propagarCamada<Saida, false>(bloco, bloco + static_cast<std::size_t>(Saida) * STRIDE, a, b);
+
+        for(int n = 0; n < Saida; n++) {
+            saidas[n] = b[n] > 0;
+            if(valores != nullptr) valores[n] = b[n];
+        }
+    }
+
+    /** Função igual a iniciar(inputs, saidas), com os tamanhos conferidos pelo tipo */
+    std::array<bool, Saida> iniciar(const std::array<double, Entrada>& inputs) const {
+        std::array<bool, Saida> saidas;
+        iniciar(inputs.data(), saidas.data());
+        return saidas;
+    }
+
+    /** Função que copia os pesos de uma RedeNeural. Retorna false se a topologia for diferente */
+    bool setRede(const RedeNeural& rede) {
+        std::vector<int> larguras(NumLayers + 2, Entrada);
+        larguras.back() = Saida;
+        if(rede.getLarguras() != larguras) {
+            return false;
+        }
+        std::copy(rede.getParametros(), rede.getParametros() + NUM_PARAMETROS, parametros.begin());
+        return true;
+    }
+
+    /** Função que copia os pesos de uma Rede. Retorna false se a estrutura for inválida ou a topologia for diferente */
+    bool setRede(const Rede& rede) {
+        RedeNeural dinamica(getVisao());
+        return dinamica.setRede(rede) && setRede(dinamica);
+    }
+
+    /** Função que retorna a rede no formato Rede, igual a RedeNeural::getRede() */
+    Rede getRede() const {
+        return getRedeNeural().getRede();
+    }
+
+    /** Função que retorna uma RedeNeural com a mesma topologia e os mesmos pesos */
+    RedeNeural getRedeNeural() const {
+        return RedeNeural(getVisao());
+    }
+
+    /** Função que retorna uma visão somente leitura desta rede, sem cópia, válida enquanto a rede existir */
+    VisaoRede getVisao() const {
+        std::vector<int> larguras(NumLayers + 2, Entrada);
+        larguras.back() = Saida;
+        return VisaoRede(larguras, parametros.data());
+    }
+
+    /** Função que retorna o bloco de parâmetros, no layout de calcularCamadas() */
+    const double* getParametros() const {
+        return parametros.data();
+    }
+
+    static constexpr int getEntrada() { return Entrada; }
+    static constexpr int getSaida() { return Saida; }
+    static constexpr int getNumLayers() { return NumLayers; }
+};
+
+// Definições dos membros constexpr usados por referência (exigidas no C++11)
+template<int Entrada, int NumLayers, int Saida>
+constexpr int RedeNeuralEstatica<Entrada, NumLayers, Saida>::STRIDE;
+template<int Entrada, int NumLayers, int Saida>
+constexpr std::size_t RedeNeuralEstatica<Entrada, NumLayers, Saida>::TAMANHO_OCULTA;
+template<int Entrada, int NumLayers, int Saida>
+constexpr std::size_t RedeNeuralEstatica<Entrada, NumLayers, Saida>::TAMANHO_SAIDA;
+template<int Entrada, int NumLayers, int Saida>
+constexpr std::size_t RedeNeuralEstatica<Entrada, NumLayers, Saida>::NUM_PARAMETROS;
+template<int Entrada, int NumLayers, int Saida>
+constexpr int RedeNeuralEstatica<Entrada, NumLayers, Saida>::LARGURA_ATIVACAO;
@@ -0,0 +1,100 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "redeNeural.hpp"
+#include "concordancia.hpp"
+
+/** Como escolher os pesos removidos pela poda */
+enum CriterioPoda {
+    PODA_LIMIAR,        // remove os pesos com |w| <= limiar
+    PODA_ESPARSIDADE    // remove a fração esparsidade dos pesos de menor |w|, contando todas as camadas juntas
+};
+
+/** Configuração da poda por magnitude. O bias nunca é podado */
+struct ConfiguracaoPoda {
+    CriterioPoda criterio = PODA_LIMIAR;
+    double limiar = 1e-3;
+    double esparsidade = 0.5;
+    double densidadeMaxima = -1.0;   // camadas com densidade até esse valor ficam em CSR; negativo mede os dois kernels em cada camada
+};
+
+/** Camada de uma RedePodada, densa (mesmo layout da RedeNeural) ou esparsa em CSR */
+struct CamadaPodada {
+    int entradas;
+    int neuronios;
+    int stride;                  // densa: entradas arredondado para múltiplo de LARGURA_SIMD
+    bool relu;
+    bool esparsa;
+    std::size_t offsetPesos;     // densa: início da matriz no bloco denso
+    std::size_t offsetBias;      // início do bias no bloco denso, densa ou esparsa
+    std::size_t offsetLinhas;    // esparsa: início dos neuronios + 1 offsets de linha em linhas
+    std::size_t naoNulos;        // pesos mantidos, sem o preenchimento das linhas esparsas
+    double densidade;            // naoNulos / (entradas x neuronios)
+};
+
+/** Rede só de inferência com os pesos pequenos podados, convertida de uma RedeNeural.
+* Cada camada fica densa ou em CSR (valores e colunas de cada linha preenchidos até um múltiplo de LARGURA_SIMD),
+* o que for mais rápido para ela. O ponto de troca depende muito do tamanho: medido com AVX-512, camadas de 1024 x 1024
+* (fora do cache) já ficam mais rápidas em CSR com 30% de densidade e 10x mais rápidas com 5%, mas camadas de 64 x 64,
+* que cabem no L1, continuam mais rápidas densas mesmo com 5%. Por isso, por padrão, os dois kernels são medidos em cada camada.
+* compararConcordancia() mede o quanto as saídas booleanas mudaram com a poda.
+*/
+class RedePodada {
+private:
+    std::vector<int> larguras;
+    std::vector<CamadaPodada> camadas;
+    VetorAlinhado densos;                                        // matrizes das camadas densas e bias de todas
+    VetorAlinhado valores;                                       // pesos das camadas esparsas, linha por linha
+    std::vector<int32_t, AlocadorAlinhado<int32_t>> colunas;     // coluna de cada valor
+    std::vector<uint32_t> linhas;                                // início de cada linha em valores, mais o fim da última
+    int entrada;
+    int saida;
+    std::size_t larguraAtivacao;
+    std::size_t pesosOriginais;
+    std::size_t pesosPodados;
+public:
+    RedePodada();
+
+    /** Cria a rede podando os pesos de uma RedeNeural */
+    RedePodada(const RedeNeural& rede, const ConfiguracaoPoda& config);
+
+    /** Função que poda os pesos de uma RedeNeural e monta as camadas, trocando a topologia se precisar */
+    void podar(const RedeNeural& rede, const ConfiguracaoPoda& config);
+
+    /** Função igual à RedeNeural::iniciar() const, com as camadas podadas. A área é a mesma da rede original */
+    bool iniciar(const double* inputs, std::size_t quantidade, bool* saidas, AreaTrabalho& area,
+                 double* valores = nullptr) const;
+
+    /** Função que retorna uma área de trabalho dimensionada para esta rede */
+    AreaTrabalho criarAreaTrabalho() const;
+
+    /** Função que escreve os pesos podados (zeros no lugar dos removidos) em uma RedeNeural, trocando a topologia se precisar.
+    * Útil para continuar a evolução ou o treinamento a partir da rede podada
+    */
+    void copiarPara(RedeNeural& destino) const;
+
+    /** Função que retorna a fração dos pesos (sem bias) removida */
+    double getEsparsidade() const {
+        return pesosOriginais > 0 ? static_cast<double>(pesosPodados) / pesosOriginais : 0.0;
+    }
+
+    /** Função que retorna quantos bytes os pesos, bias e índices ocupam */
+    std::size_t getBytesPesos() const {
+        return densos.size() * sizeof(double) + valores.size() * sizeof(double) + colunas.size() * sizeof(int32_t) +
+               linhas.size() * sizeof(uint32_t);
+    }
+
+    /** Função que retorna as camadas, com a densidade e a representação escolhida de cada uma */
+    const std::vector<CamadaPodada>& getCamadas() const {
+        return camadas;
+    }
+
+    int getEntrada() const { return entrada; }
+    int getSaida() const { return saida; }
+};
+
+/** Função que mede com que frequência cada saída booleana da rede podada difere da rede de referência (normalmente a original)
+* @param inputs - matriz amostras x entrada em row-major
+*/
+RelatorioConcordancia compararConcordancia(const RedeNeural& referencia, const RedePodada& podada,
+                                           const std::vector<double>& inputs, int amostras);
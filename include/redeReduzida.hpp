@@ -0,0 +1,85 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "redeNeural.hpp"
+#include "concordancia.hpp"
+
+/** Área de trabalho da RedeReduzida: ativações em float e, no int8, a entrada de cada camada já quantizada */
+struct AreaReduzida {
+    std::vector<float, AlocadorAlinhado<float>> ativacoes;       // 2 x largura floats
+    std::vector<int8_t, AlocadorAlinhado<int8_t>> quantizadas;   // largura int8, só usada em RedeReduzida<int8_t>
+    std::size_t largura = 0;
+};
+
+/** Camada densa de uma RedeReduzida. Cada linha de pesos é preenchida até uma linha de cache (16 floats ou 64 int8) */
+struct CamadaReduzida {
+    int entradas;
+    int neuronios;
+    int stride;                // entradas arredondado para múltiplo de ALINHAMENTO / sizeof(T)
+    std::size_t offsetPesos;   // início da matriz de pesos no bloco de pesos
+    std::size_t offsetBias;    // início do bias (sempre float) no bloco de bias
+    float escala;              // valor real = peso * escala; 1 no float, max|w| / 127 no int8
+    bool relu;
+};
+
+/** Rede só de inferência com pesos em precisão reduzida, convertida de uma RedeNeural treinada.
+* float: metade da memória dos pesos, ativações em float.
+* int8_t: um oitavo da memória, com uma escala por camada para os pesos; a entrada de cada camada é quantizada
+* por amostra (escala max|a| / 127) e o produto escalar é feito em int32.
+* Como iniciar() só devolve o sinal de cada saída, o resultado costuma ser o mesmo da rede double; compararConcordancia() mede isso.
+*/
+template<typename T>
+class RedeReduzida {
+private:
+    std::vector<CamadaReduzida> camadas;
+    std::vector<T, AlocadorAlinhado<T>> pesos;
+    std::vector<float, AlocadorAlinhado<float>> bias;
+    int entrada;
+    int saida;
+    std::size_t larguraAtivacao;
+public:
+    RedeReduzida();
+
+    /** Cria a rede convertendo os pesos de uma RedeNeural */
+    explicit RedeReduzida(const RedeNeural& rede);
+
+    /** Função que converte os pesos de uma RedeNeural, trocando a topologia se precisar */
+    void converter(const RedeNeural& rede);
+
+    /** Função igual à RedeNeural::iniciar() const, com a área de trabalho desta rede.
+    * Retorna false se quantidade não bater com a entrada ou se a área for pequena demais
+    */
+    bool iniciar(const double* inputs, std::size_t quantidade, bool* saidas, AreaReduzida& area,
+                 double* valores = nullptr) const;
+
+    /** Função que retorna uma área de trabalho dimensionada para esta rede */
+    AreaReduzida criarAreaTrabalho() const;
+
+    /** Função que retorna quantos bytes os pesos e bias ocupam */
+    std::size_t getBytesPesos() const {
+        return pesos.size() * sizeof(T) + bias.size() * sizeof(float);
+    }
+
+    /** Função que retorna as camadas, com a escala de cada uma */
+    const std::vector<CamadaReduzida>& getCamadas() const {
+        return camadas;
+    }
+
+    int getEntrada() const { return entrada; }
+    int getSaida() const { return saida; }
+};
+
+typedef RedeReduzida<float> RedeFloat;
+typedef RedeReduzida<int8_t> RedeInt8;
+
+/** Função que mede com que frequência cada saída booleana da rede reduzida difere da rede double de referência
+* @param inputs - matriz amostras x entrada em row-major
+*/
+template<typename T>
+RelatorioConcordancia compararConcordancia(const RedeNeural& referencia, const RedeReduzida<T>& reduzida,
+                                           const std::vector<double>& inputs, int amostras) {
+    AreaReduzida area = reduzida.criarAreaTrabalho();
+    return medirConcordancia(referencia, [&](const double* amostra, bool* saidas, double* valores) {
+        return reduzida.iniciar(amostra, reduzida.getEntrada(), saidas, area, valores);
+    }, inputs, amostras);
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include "redeNeural.hpp"
+#include "poolTrabalho.hpp"
+
+/** Função de perda sobre os valores brutos da camada de saída */
+enum FuncaoPerda {
+    PERDA_QUADRATICA,   // 0.5 * (valor - alvo)^2, alvos reais
+    PERDA_LOGISTICA     // entropia cruzada de sigmoid(valor) com alvos 0 ou 1, o mesmo valor > 0 que iniciar() devolve
+};
+
+/** Otimizador usado em cada passo */
+enum TipoOtimizador {
+    OTIMIZADOR_SGD,     // descida de gradiente com momento opcional
+    OTIMIZADOR_ADAM
+};
+
+/** Configuração do treinamento por gradiente */
+struct ConfiguracaoTreinamento {
+    TipoOtimizador otimizador = OTIMIZADOR_ADAM;
+    FuncaoPerda perda = PERDA_LOGISTICA;
+    double taxaAprendizado = 0.01;
+    double momento = 0.0;         // SGD: fração da velocidade anterior mantida a cada passo
+    double beta1 = 0.9;           // Adam: decaimento da média do gradiente
+    double beta2 = 0.999;         // Adam: decaimento da média do gradiente ao quadrado
+    double epsilon = 1e-8;
+    int tamanhoLote = 32;         // amostras por passo em treinarEpoca()
+    uint64_t semente = 0;         // embaralhamento das amostras em treinarEpoca(); 0 sorteia uma semente
+    int numThreads = 1;           // 0 usa std::thread::hardware_concurrency()
+};
+
+/** Treinamento por retropropagação das camadas ReLU ocultas e da camada de saída linear, em mini-lotes.
+* O lote é dividido em uma parte por thread do pool; cada parte acumula o gradiente em um buffer próprio,
+* no mesmo layout do bloco de parâmetros da rede, e os buffers são somados por blocos em paralelo antes do passo.
+* A divisão não depende de qual thread pega qual parte, então o resultado só depende do número de threads.
+* A rede treinada continua sendo uma RedeNeural normal: dá para alternar com modificarPesos() e truncamento().
+*/
+class Treinador {
+private:
+    RedeNeural& rede;
+    ConfiguracaoTreinamento config;
+    std::unique_ptr<PoolTrabalho> pool;
+    std::vector<VetorAlinhado> gradientes;   // um por parte do lote, gradientes[0] recebe a média
+    std::vector<double> perdas;              // perda somada de cada parte
+    std::vector<VetorAlinhado> ativacoes;    // por thread: a saída de cada camada, guardadas para a volta
+    std::vector<VetorAlinhado> deltas;       // por thread: dois buffers de derivadas
+    std::vector<std::size_t> offsetsAtivacao;
+    std::size_t larguraDelta;
+    VetorAlinhado momento1;                  // SGD: velocidade; Adam: média do gradiente
+    VetorAlinhado momento2;                  // Adam: média do gradiente ao quadrado
+    uint64_t passos;
+    Xoshiro256 gerador;
+    std::vector<int> ordem;
+    std::vector<double> loteInputs, loteAlvos;
+
+    /** Função que dimensiona os buffers para a topologia atual da rede, zerando o estado do otimizador se ela mudou */
+    void dimensionar();
+
+    /** Função que faz ida e volta de uma amostra, soma o gradiente em gradiente e retorna a perda */
+    double acumularAmostra(const double* input, const double* alvo, double* gradiente, int thread);
+public:
+    /** Cria o treinador para a rede, que precisa viver mais que ele */
+    Treinador(RedeNeural& rede, const ConfiguracaoTreinamento& config);
+
+    /** Função que calcula o gradiente médio da perda no lote, sem alterar a rede
+    * @param inputs - matriz amostras x entrada em row-major
+    * @param alvos - matriz amostras x saida em row-major
+    * Retorna a perda média do lote
+    */
+    double calcularGradiente(const double* inputs, const double* alvos, int amostras);
+
+    /** Função que aplica o último gradiente calculado com o otimizador configurado */
+    void aplicarGradiente();
+
+    /** Função que calcula o gradiente do lote e dá um passo. Retorna a perda média do lote antes do passo */
+    double treinarLote(const double* inputs, const double* alvos, int amostras);
+
+    /** Função que percorre todas as amostras uma vez, embaralhadas, em lotes de config.tamanhoLote.
+    * Retorna a perda média da época, ou -1 se os tamanhos não baterem
+    */
+    double treinarEpoca(const std::vector<double>& inputs, const std::vector<double>& alvos, int amostras);
+
+    /** Função que calcula a perda média sem alterar nada, com a versão const de iniciar() */
+    double calcularPerda(const std::vector<double>& inputs, const std::vector<double>& alvos, int amostras) const;
+
+    /** Função que retorna o último gradiente médio, no layout do bloco de parâmetros da rede */
+    const double* getGradiente() const {
+        return gradientes[0].data();
+    }
+
+    /** Função que retorna quantos passos o otimizador já deu */
+    uint64_t getPassos() const {
+        return passos;
+    }
+};
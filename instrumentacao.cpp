@@ -0,0 +1,248 @@
+#include "instrumentacao.hpp"
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <limits>
+#include <sstream>
+
+// Versões atômicas dos contadores: só a thread dona soma, mas o retrato e o zerar leem e escrevem de outras threads.
+// A soma é leitura + escrita relaxadas (sem lock), então um zerar no meio de uma chamada pode perder aquela contagem
+struct HistogramaAtomico {
+    std::atomic<uint64_t> contagens[NUM_FAIXAS_HISTOGRAMA];
+    std::atomic<uint64_t> quantidade;
+    std::atomic<uint64_t> somaNs;
+};
+
+struct ContadoresThread {
+    int thread;
+    std::atomic<uint64_t> chamadas[NUM_OPERACOES];
+    HistogramaAtomico tempos[NUM_OPERACOES];
+    HistogramaAtomico camadas[MAX_CAMADAS_INSTRUMENTADAS];
+    std::atomic<uint64_t> alocacoes;
+    std::atomic<uint64_t> bytesAlocados;
+};
+
+// Os contadores nunca são liberados: o retrato continua mostrando threads que já terminaram.
+// O registro é criado na primeira chamada, assim ele já existe mesmo quando o inicializador estático de outra
+// unidade de tradução mede alguma operação antes dos inicializadores deste arquivo rodarem
+static std::mutex travaRegistro;
+
+static std::vector<ContadoresThread*>& registro() {
+    static std::vector<ContadoresThread*>* contadores = new std::vector<ContadoresThread*>();
+    return *contadores;
+}
+
+static ContadoresThread& contadoresDaThread() {
+    thread_local ContadoresThread* contadores = nullptr;
+    if(contadores == nullptr) {
+        contadores = new ContadoresThread();  // Inicialização por valor zera os atômicos
+        std::lock_guard<std::mutex> trava(travaRegistro);
+        contadores->thread = static_cast<int>(registro().size());
+        registro().push_back(contadores);
+    }
+    return *contadores;
+}
+
+static void somar(std::atomic<uint64_t>& contador, uint64_t valor) {
+    contador.store(contador.load(std::memory_order_relaxed) + valor, std::memory_order_relaxed);
+}
+
+static int faixaHistograma(uint64_t duracaoNs) {
+    if(duracaoNs < 64) return 0;
+    int bit = 63 - __builtin_clzll(duracaoNs);  // floor(log2)
+    int faixa = bit - 5;
+    return faixa < NUM_FAIXAS_HISTOGRAMA ? faixa : NUM_FAIXAS_HISTOGRAMA - 1;
+}
+
+static void registrar(HistogramaAtomico& histograma, uint64_t duracaoNs) {
+    somar(histograma.contagens[faixaHistograma(duracaoNs)], 1);
+    somar(histograma.quantidade, 1);
+    somar(histograma.somaNs, duracaoNs);
+}
+
+static void zerar(HistogramaAtomico& histograma) {
+    for(auto& contagem : histograma.contagens) contagem.store(0, std::memory_order_relaxed);
+    histograma.quantidade.store(0, std::memory_order_relaxed);
+    histograma.somaNs.store(0, std::memory_order_relaxed);
+}
+
+static void acumular(const Histograma& origem, Histograma& destino) {
+    for(int f = 0; f < NUM_FAIXAS_HISTOGRAMA; f++) {
+        destino.contagens[f] += origem.contagens[f];
+    }
+    destino.quantidade += origem.quantidade;
+    destino.somaNs += origem.somaNs;
+}
+
+// Escreve as linhas _bucket (acumuladas), _sum e _count de um histograma do Prometheus
+static void escreverHistograma(std::ostringstream& texto, const std::string& nome, const std::string& rotulos,
+                               const Histograma& histograma) {
+    uint64_t acumulado = 0;
+    for(int f = 0; f < NUM_FAIXAS_HISTOGRAMA; f++) {
+        acumulado += histograma.contagens[f];
+        texto << nome << "_bucket{" << rotulos << ",le=\"";
+        if(f == NUM_FAIXAS_HISTOGRAMA - 1) texto << "+Inf";
+        else texto << Histograma::limiteSegundos(f);
+        texto << "\"} " << acumulado << "\n";
+    }
+    // Soma com todos os dígitos: na precisão padrão (6) somas acima de ~1000 s perdem resolução e o rate() fica em degraus
+    const std::streamsize precisao = texto.precision(std::numeric_limits<double>::max_digits10);
+    texto << nome << "_sum{" << rotulos << "} " << histograma.somaNs * 1e-9 << "\n";
+    texto.precision(precisao);
+    texto << nome << "_count{" << rotulos << "} " << histograma.quantidade << "\n";
+}
+
+double Histograma::limiteSegundos(int faixa) {
+    if(faixa >= NUM_FAIXAS_HISTOGRAMA - 1) return std::numeric_limits<double>::infinity();
+    return static_cast<double>(1ULL << (faixa + 6)) * 1e-9;
+}
+
+EstatisticasThread RetratoInstrumentacao::total() const {
+    EstatisticasThread soma;
+    for(const auto& thread : threads) {
+        for(int o = 0; o < NUM_OPERACOES; o++) {
+            soma.chamadas[o] += thread.chamadas[o];
+            acumular(thread.tempos[o], soma.tempos[o]);
+        }
+        for(int c = 0; c < MAX_CAMADAS_INSTRUMENTADAS; c++) {
+            acumular(thread.camadas[c], soma.camadas[c]);
+        }
+        soma.alocacoes += thread.alocacoes;
+        soma.bytesAlocados += thread.bytesAlocados;
+    }
+    return soma;
+}
+
+const char* nomeOperacao(int operacao) {
+    static const char* nomes[NUM_OPERACOES] = {"iniciar", "iniciarLote", "modificarPesos", "truncamento", "gerarPesos"};
+    return operacao >= 0 && operacao < NUM_OPERACOES ? nomes[operacao] : "desconhecida";
+}
+
+// Inicialização constante, então o gancho já vale para alocações feitas por inicializadores estáticos
+static std::atomic<GanchoAlocacao> ganchoAlocacao(nullptr);
+
+GanchoAlocacao definirGanchoAlocacao(GanchoAlocacao gancho) {
+    return ganchoAlocacao.exchange(gancho);
+}
+
+void avisarAlocacao(std::size_t bytes) {
+    GanchoAlocacao gancho = ganchoAlocacao.load(std::memory_order_acquire);
+    if(gancho != nullptr) gancho(bytes);
+}
+
+uint64_t relogioNs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void registrarChamada(int operacao, uint64_t duracaoNs) {
+    ContadoresThread& contadores = contadoresDaThread();
+    somar(contadores.chamadas[operacao], 1);
+    registrar(contadores.tempos[operacao], duracaoNs);
+}
+
+void registrarCamada(int camada, uint64_t duracaoNs) {
+    if(camada >= MAX_CAMADAS_INSTRUMENTADAS) camada = MAX_CAMADAS_INSTRUMENTADAS - 1;
+    registrar(contadoresDaThread().camadas[camada], duracaoNs);
+}
+
+void registrarAlocacao(std::size_t bytes) {
+    ContadoresThread& contadores = contadoresDaThread();
+    somar(contadores.alocacoes, 1);
+    somar(contadores.bytesAlocados, bytes);
+}
+
+#ifdef REDENEURAL_INSTRUMENTACAO
+static void copiar(const HistogramaAtomico& origem, Histograma& destino) {
+    for(int f = 0; f < NUM_FAIXAS_HISTOGRAMA; f++) {
+        destino.contagens[f] = origem.contagens[f].load(std::memory_order_relaxed);
+    }
+    destino.quantidade = origem.quantidade.load(std::memory_order_relaxed);
+    destino.somaNs = origem.somaNs.load(std::memory_order_relaxed);
+}
+#endif
+
+RetratoInstrumentacao retratoInstrumentacao() {
+    RetratoInstrumentacao retrato;
+#ifdef REDENEURAL_INSTRUMENTACAO
+    retrato.ativa = true;
+    std::lock_guard<std::mutex> trava(travaRegistro);
+    for(const ContadoresThread* contadores : registro()) {
+        EstatisticasThread estatisticas;
+        estatisticas.thread = contadores->thread;
+        for(int o = 0; o < NUM_OPERACOES; o++) {
+            estatisticas.chamadas[o] = contadores->chamadas[o].load(std::memory_order_relaxed);
+            copiar(contadores->tempos[o], estatisticas.tempos[o]);
+        }
+        for(int c = 0; c < MAX_CAMADAS_INSTRUMENTADAS; c++) {
+            copiar(contadores->camadas[c], estatisticas.camadas[c]);
+        }
+        estatisticas.alocacoes = contadores->alocacoes.load(std::memory_order_relaxed);
+        estatisticas.bytesAlocados = contadores->bytesAlocados.load(std::memory_order_relaxed);
+        retrato.threads.push_back(estatisticas);
+    }
+#endif
+    return retrato;
+}
+
+void zerarInstrumentacao() {
+    std::lock_guard<std::mutex> trava(travaRegistro);
+    for(ContadoresThread* contadores : registro()) {
+        for(int o = 0; o < NUM_OPERACOES; o++) {
+            contadores->chamadas[o].store(0, std::memory_order_relaxed);
+            zerar(contadores->tempos[o]);
+        }
+        for(auto& camada : contadores->camadas) zerar(camada);
+        contadores->alocacoes.store(0, std::memory_order_relaxed);
+        contadores->bytesAlocados.store(0, std::memory_order_relaxed);
+    }
+}
+
+std::string exportarPrometheus(const RetratoInstrumentacao& retrato) {
+    std::ostringstream texto;
+    texto << "# HELP redeneural_instrumentacao_ativa 1 se a biblioteca foi compilada com REDENEURAL_INSTRUMENTACAO\n"
+          << "# TYPE redeneural_instrumentacao_ativa gauge\n"
+          << "redeneural_instrumentacao_ativa " << (retrato.ativa ? 1 : 0) << "\n";
+    if(!retrato.ativa) return texto.str();
+
+    texto << "# HELP redeneural_chamadas_total Chamadas de cada operação por thread\n"
+          << "# TYPE redeneural_chamadas_total counter\n";
+    for(const auto& thread : retrato.threads) {
+        for(int o = 0; o < NUM_OPERACOES; o++) {
+            texto << "redeneural_chamadas_total{operacao=\"" << nomeOperacao(o) << "\",thread=\"" << thread.thread
+                  << "\"} " << thread.chamadas[o] << "\n";
+        }
+    }
+
+    texto << "# HELP redeneural_alocacoes_total Blocos alinhados alocados por thread\n"
+          << "# TYPE redeneural_alocacoes_total counter\n";
+    for(const auto& thread : retrato.threads) {
+        texto << "redeneural_alocacoes_total{thread=\"" << thread.thread << "\"} " << thread.alocacoes << "\n";
+    }
+    texto << "# HELP redeneural_alocacoes_bytes_total Bytes alocados em blocos alinhados por thread\n"
+          << "# TYPE redeneural_alocacoes_bytes_total counter\n";
+    for(const auto& thread : retrato.threads) {
+        texto << "redeneural_alocacoes_bytes_total{thread=\"" << thread.thread << "\"} " << thread.bytesAlocados << "\n";
+    }
+
+    // Histogramas somados entre as threads, por thread ficam no retrato
+    const EstatisticasThread total = retrato.total();
+    texto << "# HELP redeneural_duracao_segundos Duração de cada operação\n"
+          << "# TYPE redeneural_duracao_segundos histogram\n";
+    for(int o = 0; o < NUM_OPERACOES; o++) {
+        escreverHistograma(texto, "redeneural_duracao_segundos", std::string("operacao=\"") + nomeOperacao(o) + "\"",
+                           total.tempos[o]);
+    }
+    texto << "# HELP redeneural_camada_duracao_segundos Duração de cada camada no forward por amostra\n"
+          << "# TYPE redeneural_camada_duracao_segundos histogram\n";
+    for(int c = 0; c < MAX_CAMADAS_INSTRUMENTADAS; c++) {
+        if(total.camadas[c].quantidade == 0) continue;
+        escreverHistograma(texto, "redeneural_camada_duracao_segundos", "camada=\"" + std::to_string(c) + "\"",
+                           total.camadas[c]);
+    }
+    return texto.str();
+}
+
+std::string exportarPrometheus() {
+    return exportarPrometheus(retratoInstrumentacao());
+}
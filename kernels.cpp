@@ -0,0 +1,542 @@
+#include "kernels.hpp"
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define REDENEURAL_X86 1
+#include <immintrin.h>
+#endif
+
+// ---------------------------------------------------------------------------------------------
+// Versão escalar: quatro acumuladores para quebrar a dependência serial da soma
+
+static double produtoEscalarEscalar(const double* a, const double* b, int n) {
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for(int i = 0; i < n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+static void camadaEscalar(const double* pesos, const double* bias, const double* entrada, double* saida,
+                          int neuronios, int stride, bool relu) {
+    for(int j = 0; j < neuronios; j++) {
+        double soma = bias[j] + produtoEscalarEscalar(pesos + static_cast<long>(j) * stride, entrada, stride);
+        saida[j] = (relu && soma < 0) ? 0 : soma;
+    }
+}
+
+static void limiarEscalar(const double* valores, bool* saidas, int n) {
+    for(int i = 0; i < n; i++) {
+        saidas[i] = valores[i] > 0;
+    }
+}
+
+// Micro-kernel 4 amostras x 4 neurônios: cada peso carregado é usado em 4 amostras e cada entrada em 4 neurônios
+static void bloco4x4Escalar(const double* a, int strideA, const double* w, int strideW,
+                            double* c, int strideC, int k0, int k1) {
+    double c00 = 0, c01 = 0, c02 = 0, c03 = 0;
+    double c10 = 0, c11 = 0, c12 = 0, c13 = 0;
+    double c20 = 0, c21 = 0, c22 = 0, c23 = 0;
+    double c30 = 0, c31 = 0, c32 = 0, c33 = 0;
+    const double* a0 = a;
+    const double* a1 = a + strideA;
+    const double* a2 = a1 + strideA;
+    const double* a3 = a2 + strideA;
+    const double* w0 = w;
+    const double* w1 = w + strideW;
+    const double* w2 = w1 + strideW;
+    const double* w3 = w2 + strideW;
+
+    for(int k = k0; k < k1; k++) {
+        double x0 = a0[k], x1 = a1[k], x2 = a2[k], x3 = a3[k];
+        double p0 = w0[k], p1 = w1[k], p2 = w2[k], p3 = w3[k];
+        c00 += x0 * p0; c01 += x0 * p1; c02 += x0 * p2; c03 += x0 * p3;
+        c10 += x1 * p0; c11 += x1 * p1; c12 += x1 * p2; c13 += x1 * p3;
+        c20 += x2 * p0; c21 += x2 * p1; c22 += x2 * p2; c23 += x2 * p3;
+        c30 += x3 * p0; c31 += x3 * p1; c32 += x3 * p2; c33 += x3 * p3;
+    }
+
+    c[0] += c00; c[1] += c01; c[2] += c02; c[3] += c03;
+    c += strideC;
+    c[0] += c10; c[1] += c11; c[2] += c12; c[3] += c13;
+    c += strideC;
+    c[0] += c20; c[1] += c21; c[2] += c22; c[3] += c23;
+    c += strideC;
+    c[0] += c30; c[1] += c31; c[2] += c32; c[3] += c33;
+}
+
+static float produtoEscalarFloatEscalar(const float* a, const float* b, int n) {
+    float s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    for(int i = 0; i < n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+static int32_t produtoEscalarInt8Escalar(const int8_t* a, const int8_t* b, int n) {
+    int32_t soma = 0;
+    for(int i = 0; i < n; i++) {
+        soma += static_cast<int32_t>(a[i]) * b[i];
+    }
+    return soma;
+}
+
+static void camadaEsparsaEscalar(const double* valores, const int32_t* colunas, const uint32_t* linhas, const double* bias,
+                                 const double* entrada, double* saida, int neuronios, bool relu) {
+    for(int j = 0; j < neuronios; j++) {
+        double soma = 0;
+        for(uint32_t k = linhas[j]; k < linhas[j + 1]; k++) {
+            soma += valores[k] * entrada[colunas[k]];
+        }
+        soma += bias[j];
+        saida[j] = (relu && soma < 0) ? 0 : soma;
+    }
+}
+
+static const Kernels KERNELS_ESCALAR = {"escalar", produtoEscalarEscalar, camadaEscalar, bloco4x4Escalar,
+                                        produtoEscalarFloatEscalar, produtoEscalarInt8Escalar, camadaEsparsaEscalar,
+                                        limiarEscalar};
+
+#ifdef REDENEURAL_X86
+
+// ---------------------------------------------------------------------------------------------
+// SSE2: 2 doubles por registrador, quatro acumuladores independentes
+
+__attribute__((target("sse2")))
+static double produtoEscalarSse2(const double* a, const double* b, int n) {
+    __m128d s0 = _mm_setzero_pd(), s1 = _mm_setzero_pd(), s2 = _mm_setzero_pd(), s3 = _mm_setzero_pd();
+    for(int i = 0; i < n; i += 8) {
+        s0 = _mm_add_pd(s0, _mm_mul_pd(_mm_load_pd(a + i), _mm_load_pd(b + i)));
+        s1 = _mm_add_pd(s1, _mm_mul_pd(_mm_load_pd(a + i + 2), _mm_load_pd(b + i + 2)));
+        s2 = _mm_add_pd(s2, _mm_mul_pd(_mm_load_pd(a + i + 4), _mm_load_pd(b + i + 4)));
+        s3 = _mm_add_pd(s3, _mm_mul_pd(_mm_load_pd(a + i + 6), _mm_load_pd(b + i + 6)));
+    }
+    __m128d s = _mm_add_pd(_mm_add_pd(s0, s1), _mm_add_pd(s2, s3));
+    return _mm_cvtsd_f64(_mm_add_sd(s, _mm_unpackhi_pd(s, s)));
+}
+
+__attribute__((target("sse2")))
+static void camadaSse2(const double* pesos, const double* bias, const double* entrada, double* saida,
+                       int neuronios, int stride, bool relu) {
+    for(int j = 0; j < neuronios; j++) {
+        double soma = bias[j] + produtoEscalarSse2(pesos + static_cast<long>(j) * stride, entrada, stride);
+        saida[j] = (relu && soma < 0) ? 0 : soma;
+    }
+}
+
+__attribute__((target("sse2")))
+static void limiarSse2(const double* valores, bool* saidas, int n) {
+    const __m128d zero = _mm_setzero_pd();
+    int i = 0;
+    for(; i + 2 <= n; i += 2) {
+        int mascara = _mm_movemask_pd(_mm_cmpgt_pd(_mm_loadu_pd(valores + i), zero));
+        saidas[i] = mascara & 1;
+        saidas[i + 1] = (mascara >> 1) & 1;
+    }
+    for(; i < n; i++) {
+        saidas[i] = valores[i] > 0;
+    }
+}
+
+__attribute__((target("sse2")))
+static float produtoEscalarFloatSse2(const float* a, const float* b, int n) {
+    __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps(), s2 = _mm_setzero_ps(), s3 = _mm_setzero_ps();
+    for(int i = 0; i < n; i += 16) {
+        s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_load_ps(a + i), _mm_load_ps(b + i)));
+        s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_load_ps(a + i + 4), _mm_load_ps(b + i + 4)));
+        s2 = _mm_add_ps(s2, _mm_mul_ps(_mm_load_ps(a + i + 8), _mm_load_ps(b + i + 8)));
+        s3 = _mm_add_ps(s3, _mm_mul_ps(_mm_load_ps(a + i + 12), _mm_load_ps(b + i + 12)));
+    }
+    __m128 s = _mm_add_ps(_mm_add_ps(s0, s1), _mm_add_ps(s2, s3));
+    s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+    s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+    return _mm_cvtss_f32(s);
+}
+
+// SSE2 não tem registradores suficientes para ganhar da versão escalar no bloco 4x4,
+// nem extensão de sinal de int8 (só a partir do SSE4.1), nem gather para a camada esparsa (só a partir do AVX2)
+static const Kernels KERNELS_SSE2 = {"sse2", produtoEscalarSse2, camadaSse2, bloco4x4Escalar,
+                                     produtoEscalarFloatSse2, produtoEscalarInt8Escalar, camadaEsparsaEscalar,
+                                     limiarSse2};
+
+// ---------------------------------------------------------------------------------------------
+// AVX2 + FMA: 4 doubles por registrador, dois acumuladores por linha de 8
+
+__attribute__((target("avx2,fma")))
+static inline double somaHorizontalAvx(__m256d s) {
+    __m128d baixo = _mm256_castpd256_pd128(s);
+    __m128d alto = _mm256_extractf128_pd(s, 1);
+    __m128d t = _mm_add_pd(baixo, alto);
+    return _mm_cvtsd_f64(_mm_add_sd(t, _mm_unpackhi_pd(t, t)));
+}
+
+__attribute__((target("avx2,fma")))
+static double produtoEscalarAvx2(const double* a, const double* b, int n) {
+    __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+    for(int i = 0; i < n; i += 8) {
+        s0 = _mm256_fmadd_pd(_mm256_load_pd(a + i), _mm256_load_pd(b + i), s0);
+        s1 = _mm256_fmadd_pd(_mm256_load_pd(a + i + 4), _mm256_load_pd(b + i + 4), s1);
+    }
+    return somaHorizontalAvx(_mm256_add_pd(s0, s1));
+}
+
+__attribute__((target("avx2,fma")))
+static void camadaAvx2(const double* pesos, const double* bias, const double* entrada, double* saida,
+                       int neuronios, int stride, bool relu) {
+    int j = 0;
+    // Duas linhas por vez: cada bloco da entrada é carregado uma vez para os dois neurônios
+    for(; j + 2 <= neuronios; j += 2) {
+        const double* w0 = pesos + static_cast<long>(j) * stride;
+        const double* w1 = w0 + stride;
+        __m256d a0 = _mm256_setzero_pd(), a1 = _mm256_setzero_pd();
+        __m256d b0 = _mm256_setzero_pd(), b1 = _mm256_setzero_pd();
+        for(int i = 0; i < stride; i += 8) {
+            __m256d x0 = _mm256_load_pd(entrada + i);
+            __m256d x1 = _mm256_load_pd(entrada + i + 4);
+            a0 = _mm256_fmadd_pd(_mm256_load_pd(w0 + i), x0, a0);
+            a1 = _mm256_fmadd_pd(_mm256_load_pd(w0 + i + 4), x1, a1);
+            b0 = _mm256_fmadd_pd(_mm256_load_pd(w1 + i), x0, b0);
+            b1 = _mm256_fmadd_pd(_mm256_load_pd(w1 + i + 4), x1, b1);
+        }
+        double soma0 = bias[j] + somaHorizontalAvx(_mm256_add_pd(a0, a1));
+        double soma1 = bias[j + 1] + somaHorizontalAvx(_mm256_add_pd(b0, b1));
+        saida[j] = (relu && soma0 < 0) ? 0 : soma0;
+        saida[j + 1] = (relu && soma1 < 0) ? 0 : soma1;
+    }
+    for(; j < neuronios; j++) {
+        double soma = bias[j] + produtoEscalarAvx2(pesos + static_cast<long>(j) * stride, entrada, stride);
+        saida[j] = (relu && soma < 0) ? 0 : soma;
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void limiarAvx2(const double* valores, bool* saidas, int n) {
+    const __m256d zero = _mm256_setzero_pd();
+    int i = 0;
+    for(; i + 4 <= n; i += 4) {
+        int mascara = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(valores + i), zero, _CMP_GT_OQ));
+        saidas[i] = mascara & 1;
+        saidas[i + 1] = (mascara >> 1) & 1;
+        saidas[i + 2] = (mascara >> 2) & 1;
+        saidas[i + 3] = (mascara >> 3) & 1;
+    }
+    for(; i < n; i++) {
+        saidas[i] = valores[i] > 0;
+    }
+}
+
+// Meio bloco: 2 amostras x 4 neurônios, 8 acumuladores + 6 cargas cabem nos 16 registradores ymm
+__attribute__((target("avx2,fma")))
+static inline void bloco2x4Avx2(const double* a, int strideA, const double* w, int strideW,
+                                double* c, int strideC, int k0, int k1) {
+    const double* a0 = a;
+    const double* a1 = a + strideA;
+    const double* w0 = w;
+    const double* w1 = w + strideW;
+    const double* w2 = w1 + strideW;
+    const double* w3 = w2 + strideW;
+    __m256d s00 = _mm256_setzero_pd(), s01 = _mm256_setzero_pd(), s02 = _mm256_setzero_pd(), s03 = _mm256_setzero_pd();
+    __m256d s10 = _mm256_setzero_pd(), s11 = _mm256_setzero_pd(), s12 = _mm256_setzero_pd(), s13 = _mm256_setzero_pd();
+
+    for(int k = k0; k < k1; k += 4) {
+        __m256d x0 = _mm256_load_pd(a0 + k);
+        __m256d x1 = _mm256_load_pd(a1 + k);
+        __m256d p = _mm256_load_pd(w0 + k);
+        s00 = _mm256_fmadd_pd(x0, p, s00);
+        s10 = _mm256_fmadd_pd(x1, p, s10);
+        p = _mm256_load_pd(w1 + k);
+        s01 = _mm256_fmadd_pd(x0, p, s01);
+        s11 = _mm256_fmadd_pd(x1, p, s11);
+        p = _mm256_load_pd(w2 + k);
+        s02 = _mm256_fmadd_pd(x0, p, s02);
+        s12 = _mm256_fmadd_pd(x1, p, s12);
+        p = _mm256_load_pd(w3 + k);
+        s03 = _mm256_fmadd_pd(x0, p, s03);
+        s13 = _mm256_fmadd_pd(x1, p, s13);
+    }
+
+    // Reduz os 4 acumuladores de cada amostra de uma vez: hadd + permutação deixa [s0, s1, s2, s3] em um registrador
+    __m256d t0 = _mm256_hadd_pd(s00, s01);
+    __m256d t1 = _mm256_hadd_pd(s02, s03);
+    __m256d r0 = _mm256_add_pd(_mm256_permute2f128_pd(t0, t1, 0x20), _mm256_permute2f128_pd(t0, t1, 0x31));
+    _mm256_storeu_pd(c, _mm256_add_pd(_mm256_loadu_pd(c), r0));
+
+    t0 = _mm256_hadd_pd(s10, s11);
+    t1 = _mm256_hadd_pd(s12, s13);
+    __m256d r1 = _mm256_add_pd(_mm256_permute2f128_pd(t0, t1, 0x20), _mm256_permute2f128_pd(t0, t1, 0x31));
+    _mm256_storeu_pd(c + strideC, _mm256_add_pd(_mm256_loadu_pd(c + strideC), r1));
+}
+
+__attribute__((target("avx2,fma")))
+static void bloco4x4Avx2(const double* a, int strideA, const double* w, int strideW,
+                         double* c, int strideC, int k0, int k1) {
+    bloco2x4Avx2(a, strideA, w, strideW, c, strideC, k0, k1);
+    bloco2x4Avx2(a + 2 * strideA, strideA, w, strideW, c + 2 * strideC, strideC, k0, k1);
+}
+
+__attribute__((target("avx2,fma")))
+static float produtoEscalarFloatAvx2(const float* a, const float* b, int n) {
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    for(int i = 0; i < n; i += 16) {
+        s0 = _mm256_fmadd_ps(_mm256_load_ps(a + i), _mm256_load_ps(b + i), s0);
+        s1 = _mm256_fmadd_ps(_mm256_load_ps(a + i + 8), _mm256_load_ps(b + i + 8), s1);
+    }
+    __m256 s = _mm256_add_ps(s0, s1);
+    __m128 t = _mm_add_ps(_mm256_castps256_ps128(s), _mm256_extractf128_ps(s, 1));
+    t = _mm_add_ps(t, _mm_movehl_ps(t, t));
+    t = _mm_add_ss(t, _mm_shuffle_ps(t, t, 1));
+    return _mm_cvtss_f32(t);
+}
+
+// maddubs multiplica unsigned x signed: |a| x (b com o sinal de a) dá o mesmo produto, e com valores em [-127, 127]
+// a soma de cada par cabe em int16 sem saturar
+__attribute__((target("avx2,fma")))
+static int32_t produtoEscalarInt8Avx2(const int8_t* a, const int8_t* b, int n) {
+    const __m256i uns = _mm256_set1_epi16(1);
+    __m256i s0 = _mm256_setzero_si256(), s1 = _mm256_setzero_si256();
+    for(int i = 0; i < n; i += 64) {
+        __m256i a0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(a + i));
+        __m256i b0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(b + i));
+        __m256i a1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(a + i + 32));
+        __m256i b1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(b + i + 32));
+        __m256i p0 = _mm256_maddubs_epi16(_mm256_abs_epi8(a0), _mm256_sign_epi8(b0, a0));
+        __m256i p1 = _mm256_maddubs_epi16(_mm256_abs_epi8(a1), _mm256_sign_epi8(b1, a1));
+        s0 = _mm256_add_epi32(s0, _mm256_madd_epi16(p0, uns));
+        s1 = _mm256_add_epi32(s1, _mm256_madd_epi16(p1, uns));
+    }
+    __m256i s = _mm256_add_epi32(s0, s1);
+    __m128i t = _mm_add_epi32(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1));
+    t = _mm_add_epi32(t, _mm_shuffle_epi32(t, 0x4E));
+    t = _mm_add_epi32(t, _mm_shuffle_epi32(t, 0xB1));
+    return _mm_cvtsi128_si32(t);
+}
+
+// Gather de 4 entradas por vez, dois acumuladores por grupo de 8 elementos da linha
+__attribute__((target("avx2,fma")))
+static void camadaEsparsaAvx2(const double* valores, const int32_t* colunas, const uint32_t* linhas, const double* bias,
+                              const double* entrada, double* saida, int neuronios, bool relu) {
+    for(int j = 0; j < neuronios; j++) {
+        __m256d s0 = _mm256_setzero_pd(), s1 = _mm256_setzero_pd();
+        for(uint32_t k = linhas[j]; k < linhas[j + 1]; k += 8) {
+            __m128i i0 = _mm_load_si128(reinterpret_cast<const __m128i*>(colunas + k));
+            __m128i i1 = _mm_load_si128(reinterpret_cast<const __m128i*>(colunas + k + 4));
+            s0 = _mm256_fmadd_pd(_mm256_load_pd(valores + k), _mm256_i32gather_pd(entrada, i0, 8), s0);
+            s1 = _mm256_fmadd_pd(_mm256_load_pd(valores + k + 4), _mm256_i32gather_pd(entrada, i1, 8), s1);
+        }
+        double soma = bias[j] + somaHorizontalAvx(_mm256_add_pd(s0, s1));
+        saida[j] = (relu && soma < 0) ? 0 : soma;
+    }
+}
+
+static const Kernels KERNELS_AVX2 = {"avx2", produtoEscalarAvx2, camadaAvx2, bloco4x4Avx2,
+                                     produtoEscalarFloatAvx2, produtoEscalarInt8Avx2, camadaEsparsaAvx2, limiarAvx2};
+
+// ---------------------------------------------------------------------------------------------
+// AVX-512: uma linha de cache (8 doubles) por registrador
+
+// Reduz 4 acumuladores zmm para [soma(s0), soma(s1), soma(s2), soma(s3)] em um único ymm
+__attribute__((target("avx512f")))
+static inline __m256d reduzir4Avx512(__m512d s0, __m512d s1, __m512d s2, __m512d s3) {
+    __m256d t0 = _mm256_add_pd(_mm512_castpd512_pd256(s0), _mm512_extractf64x4_pd(s0, 1));
+    __m256d t1 = _mm256_add_pd(_mm512_castpd512_pd256(s1), _mm512_extractf64x4_pd(s1, 1));
+    __m256d t2 = _mm256_add_pd(_mm512_castpd512_pd256(s2), _mm512_extractf64x4_pd(s2, 1));
+    __m256d t3 = _mm256_add_pd(_mm512_castpd512_pd256(s3), _mm512_extractf64x4_pd(s3, 1));
+    __m256d h0 = _mm256_hadd_pd(t0, t1);
+    __m256d h1 = _mm256_hadd_pd(t2, t3);
+    return _mm256_add_pd(_mm256_permute2f128_pd(h0, h1, 0x20), _mm256_permute2f128_pd(h0, h1, 0x31));
+}
+
+__attribute__((target("avx512f")))
+static double produtoEscalarAvx512(const double* a, const double* b, int n) {
+    __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+    int i = 0;
+    for(; i + 16 <= n; i += 16) {
+        s0 = _mm512_fmadd_pd(_mm512_load_pd(a + i), _mm512_load_pd(b + i), s0);
+        s1 = _mm512_fmadd_pd(_mm512_load_pd(a + i + 8), _mm512_load_pd(b + i + 8), s1);
+    }
+    if(i < n) {
+        s0 = _mm512_fmadd_pd(_mm512_load_pd(a + i), _mm512_load_pd(b + i), s0);
+    }
+    return _mm512_reduce_add_pd(_mm512_add_pd(s0, s1));
+}
+
+__attribute__((target("avx512f")))
+static void camadaAvx512(const double* pesos, const double* bias, const double* entrada, double* saida,
+                         int neuronios, int stride, bool relu) {
+    int j = 0;
+    // Quatro linhas por vez, reaproveitando cada bloco da entrada
+    for(; j + 4 <= neuronios; j += 4) {
+        const double* w0 = pesos + static_cast<long>(j) * stride;
+        const double* w1 = w0 + stride;
+        const double* w2 = w1 + stride;
+        const double* w3 = w2 + stride;
+        __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+        __m512d s2 = _mm512_setzero_pd(), s3 = _mm512_setzero_pd();
+        for(int i = 0; i < stride; i += 8) {
+            __m512d x = _mm512_load_pd(entrada + i);
+            s0 = _mm512_fmadd_pd(_mm512_load_pd(w0 + i), x, s0);
+            s1 = _mm512_fmadd_pd(_mm512_load_pd(w1 + i), x, s1);
+            s2 = _mm512_fmadd_pd(_mm512_load_pd(w2 + i), x, s2);
+            s3 = _mm512_fmadd_pd(_mm512_load_pd(w3 + i), x, s3);
+        }
+        __m256d somas = _mm256_add_pd(reduzir4Avx512(s0, s1, s2, s3), _mm256_loadu_pd(bias + j));
+        if(relu) {
+            somas = _mm256_max_pd(somas, _mm256_setzero_pd());
+        }
+        _mm256_storeu_pd(saida + j, somas);
+    }
+    for(; j < neuronios; j++) {
+        double soma = bias[j] + produtoEscalarAvx512(pesos + static_cast<long>(j) * stride, entrada, stride);
+        saida[j] = (relu && soma < 0) ? 0 : soma;
+    }
+}
+
+__attribute__((target("avx512f")))
+static void limiarAvx512(const double* valores, bool* saidas, int n) {
+    int i = 0;
+    for(; i + 8 <= n; i += 8) {
+        __mmask8 mascara = _mm512_cmp_pd_mask(_mm512_loadu_pd(valores + i), _mm512_setzero_pd(), _CMP_GT_OQ);
+        for(int b = 0; b < 8; b++) {
+            saidas[i + b] = (mascara >> b) & 1;
+        }
+    }
+    for(; i < n; i++) {
+        saidas[i] = valores[i] > 0;
+    }
+}
+
+// 4 amostras x 4 neurônios com 16 acumuladores zmm, sobram registradores para as 8 cargas
+__attribute__((target("avx512f")))
+static void bloco4x4Avx512(const double* a, int strideA, const double* w, int strideW,
+                           double* c, int strideC, int k0, int k1) {
+    const double* a0 = a;
+    const double* a1 = a + strideA;
+    const double* a2 = a1 + strideA;
+    const double* a3 = a2 + strideA;
+    const double* w0 = w;
+    const double* w1 = w + strideW;
+    const double* w2 = w1 + strideW;
+    const double* w3 = w2 + strideW;
+    __m512d s00 = _mm512_setzero_pd(), s01 = _mm512_setzero_pd(), s02 = _mm512_setzero_pd(), s03 = _mm512_setzero_pd();
+    __m512d s10 = _mm512_setzero_pd(), s11 = _mm512_setzero_pd(), s12 = _mm512_setzero_pd(), s13 = _mm512_setzero_pd();
+    __m512d s20 = _mm512_setzero_pd(), s21 = _mm512_setzero_pd(), s22 = _mm512_setzero_pd(), s23 = _mm512_setzero_pd();
+    __m512d s30 = _mm512_setzero_pd(), s31 = _mm512_setzero_pd(), s32 = _mm512_setzero_pd(), s33 = _mm512_setzero_pd();
+
+    for(int k = k0; k < k1; k += 8) {
+        __m512d x0 = _mm512_load_pd(a0 + k), x1 = _mm512_load_pd(a1 + k);
+        __m512d x2 = _mm512_load_pd(a2 + k), x3 = _mm512_load_pd(a3 + k);
+        __m512d p = _mm512_load_pd(w0 + k);
+        s00 = _mm512_fmadd_pd(x0, p, s00); s10 = _mm512_fmadd_pd(x1, p, s10);
+        s20 = _mm512_fmadd_pd(x2, p, s20); s30 = _mm512_fmadd_pd(x3, p, s30);
+        p = _mm512_load_pd(w1 + k);
+        s01 = _mm512_fmadd_pd(x0, p, s01); s11 = _mm512_fmadd_pd(x1, p, s11);
+        s21 = _mm512_fmadd_pd(x2, p, s21); s31 = _mm512_fmadd_pd(x3, p, s31);
+        p = _mm512_load_pd(w2 + k);
+        s02 = _mm512_fmadd_pd(x0, p, s02); s12 = _mm512_fmadd_pd(x1, p, s12);
+        s22 = _mm512_fmadd_pd(x2, p, s22); s32 = _mm512_fmadd_pd(x3, p, s32);
+        p = _mm512_load_pd(w3 + k);
+        s03 = _mm512_fmadd_pd(x0, p, s03); s13 = _mm512_fmadd_pd(x1, p, s13);
+        s23 = _mm512_fmadd_pd(x2, p, s23); s33 = _mm512_fmadd_pd(x3, p, s33);
+    }
+
+    _mm256_storeu_pd(c, _mm256_add_pd(_mm256_loadu_pd(c), reduzir4Avx512(s00, s01, s02, s03)));
+    c += strideC;
+    _mm256_storeu_pd(c, _mm256_add_pd(_mm256_loadu_pd(c), reduzir4Avx512(s10, s11, s12, s13)));
+    c += strideC;
+    _mm256_storeu_pd(c, _mm256_add_pd(_mm256_loadu_pd(c), reduzir4Avx512(s20, s21, s22, s23)));
+    c += strideC;
+    _mm256_storeu_pd(c, _mm256_add_pd(_mm256_loadu_pd(c), reduzir4Avx512(s30, s31, s32, s33)));
+}
+
+__attribute__((target("avx512f")))
+static float produtoEscalarFloatAvx512(const float* a, const float* b, int n) {
+    __m512 s = _mm512_setzero_ps();
+    for(int i = 0; i < n; i += 16) {
+        s = _mm512_fmadd_ps(_mm512_load_ps(a + i), _mm512_load_ps(b + i), s);
+    }
+    return _mm512_reduce_add_ps(s);
+}
+
+// Gather de 8 entradas (uma linha de cache de valores) por vez, dois acumuladores quando a linha tem 16 ou mais
+__attribute__((target("avx512f")))
+static void camadaEsparsaAvx512(const double* valores, const int32_t* colunas, const uint32_t* linhas, const double* bias,
+                                const double* entrada, double* saida, int neuronios, bool relu) {
+    for(int j = 0; j < neuronios; j++) {
+        __m512d s0 = _mm512_setzero_pd(), s1 = _mm512_setzero_pd();
+        uint32_t k = linhas[j];
+        const uint32_t fim = linhas[j + 1];
+        for(; k + 16 <= fim; k += 16) {
+            __m256i i0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(colunas + k));
+            __m256i i1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(colunas + k + 8));
+            s0 = _mm512_fmadd_pd(_mm512_load_pd(valores + k), _mm512_i32gather_pd(i0, entrada, 8), s0);
+            s1 = _mm512_fmadd_pd(_mm512_load_pd(valores + k + 8), _mm512_i32gather_pd(i1, entrada, 8), s1);
+        }
+        if(k < fim) {
+            __m256i i0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(colunas + k));
+            s0 = _mm512_fmadd_pd(_mm512_load_pd(valores + k), _mm512_i32gather_pd(i0, entrada, 8), s0);
+        }
+        double soma = bias[j] + _mm512_reduce_add_pd(_mm512_add_pd(s0, s1));
+        saida[j] = (relu && soma < 0) ? 0 : soma;
+    }
+}
+
+// Toda CPU com AVX-512F também tem AVX2, o int8 usa a versão AVX2 para não exigir AVX-512BW
+static const Kernels KERNELS_AVX512 = {"avx512", produtoEscalarAvx512, camadaAvx512, bloco4x4Avx512,
+                                       produtoEscalarFloatAvx512, produtoEscalarInt8Avx2, camadaEsparsaAvx512,
+                                       limiarAvx512};
+
+#endif
+
+// ---------------------------------------------------------------------------------------------
+// Escolha pela CPU
+
+std::vector<const Kernels*> kernelsDisponiveis() {
+    std::vector<const Kernels*> disponiveis;
+    disponiveis.push_back(&KERNELS_ESCALAR);
+#ifdef REDENEURAL_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("sse2")) {
+        disponiveis.push_back(&KERNELS_SSE2);
+    }
+    if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        disponiveis.push_back(&KERNELS_AVX2);
+    }
+    if(__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx2")) {
+        disponiveis.push_back(&KERNELS_AVX512);
+    }
+#endif
+    return disponiveis;
+}
+
+static const Kernels* escolherKernels() {
+    std::vector<const Kernels*> disponiveis = kernelsDisponiveis();
+
+    const char* forcado = std::getenv("REDENEURAL_KERNEL");
+    if(forcado != nullptr) {
+        for(const Kernels* k : disponiveis) {
+            if(std::strcmp(k->nome, forcado) == 0) return k;
+        }
+    }
+    return disponiveis.back();
+}
+
+// Inicializado na carga da biblioteca, kernelsAtivos() cobre chamadas feitas antes disso por outros inicializadores estáticos
+static const Kernels* kernelsEscolhidos = escolherKernels();
+
+const Kernels& kernelsAtivos() {
+    if(kernelsEscolhidos == nullptr) {
+        kernelsEscolhidos = escolherKernels();
+    }
+    return *kernelsEscolhidos;
+}
+
+const Kernels& kernelsEscalar() {
+    return KERNELS_ESCALAR;
+}
@@ -2,7 +2,27 @@
 #include <iostream>
 #include <cassert>
 #include <iomanip>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <thread>
+#include <atomic>
+#include <stdexcept>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
 #include "redeNeural.hpp"
+#include "kernels.hpp"
+#include "evolucao.hpp"
+#include "modelo.hpp"
+#include "redeReduzida.hpp"
+#include "redeEstatica.hpp"
+#include "instrumentacao.hpp"
+#include "treinamento.hpp"
+#include "redeCompartilhada.hpp"
+#include "conjuntoDados.hpp"
+#include "redePodada.hpp"
 
 // Função auxiliar para verificar se um número está no intervalo [-1, 1]
 bool estaDentroDoIntervalo(double valor) {
@@ -197,6 +217,1264 @@ bool testarTruncamento() {
     return sucesso;
 }
 
+// Calcula os valores de saída a partir da estrutura Rede, neurônio por neurônio, para comparar com o caminho rápido
+std::vector<double> calcularReferencia(const Rede& estrutura, const std::vector<double>& inputs) {
+    std::vector<double> anterior = inputs;
+    anterior.push_back(1.0);  // Bias da entrada
+    for(size_t l = 1; l < estrutura.layers.size(); l++) {
+        bool oculto = l < estrutura.layers.size() - 1;
+        size_t quantidade = estrutura.layers[l].neuronios.size() - (oculto ? 1 : 0);
+        std::vector<double> atual;
+        for(size_t n = 0; n < quantidade; n++) {
+            double soma = 0.0;
+            for(size_t prev = 0; prev < anterior.size(); prev++) {
+                soma += anterior[prev] * estrutura.layers[l].neuronios[n].pesos[prev];
+            }
+            atual.push_back(oculto && soma < 0 ? 0 : soma);
+        }
+        if(oculto) atual.push_back(1.0);
+        anterior = atual;
+    }
+    return anterior;
+}
+
+// Testa o layout contíguo: alinhamento dos blocos, ida e volta por getRede/setRede e a saída contra a referência
+bool testarLayoutContiguo() {
+    RedeNeural rede(13, 3, 5);  // Larguras que não são múltiplas da largura SIMD
+    bool sucesso = true;
+
+    for(const auto& camada : rede.getCamadas()) {
+        const double* pesos = rede.getParametros() + camada.offsetPesos;
+        const double* bias = rede.getParametros() + camada.offsetBias;
+        if(reinterpret_cast<uintptr_t>(pesos) % ALINHAMENTO != 0 || reinterpret_cast<uintptr_t>(bias) % ALINHAMENTO != 0) {
+            std::cout << "Bloco de pesos desalinhado" << std::endl;
+            sucesso = false;
+        }
+        if(camada.stride % LARGURA_SIMD != 0 || camada.stride < camada.entradas) {
+            std::cout << "Stride incorreto: " << camada.stride << std::endl;
+            sucesso = false;
+        }
+    }
+
+    Rede estrutura = rede.getRede();
+    RedeNeural copia(1, 0, 1);
+    if(!copia.setRede(estrutura)) {
+        std::cout << "setRede recusou uma rede válida" << std::endl;
+        return false;
+    }
+
+    std::vector<double> inputs;
+    for(int i = 0; i < 13; i++) inputs.push_back((i % 5) * 0.3 - 0.6);
+
+    std::vector<double> referencia = calcularReferencia(estrutura, inputs);
+    std::vector<bool> resultado = rede.iniciar(inputs);
+    std::vector<bool> resultadoCopia = copia.iniciar(inputs);
+    for(size_t i = 0; i < referencia.size(); i++) {
+        if(resultado[i] != (referencia[i] > 0) || resultadoCopia[i] != resultado[i]) {
+            std::cout << "Saída " << i << " diferente da referência" << std::endl;
+            sucesso = false;
+        }
+    }
+
+    // Estrutura inválida: pesos a menos no layer de saída
+    estrutura.layers.back().neuronios[0].pesos.pop_back();
+    if(copia.setRede(estrutura)) {
+        std::cout << "setRede aceitou uma rede inválida" << std::endl;
+        sucesso = false;
+    }
+
+    return sucesso;
+}
+
+// Testa iniciarLote() contra iniciar() chamado amostra por amostra, abaixo e acima de LOTE_MINIMO e com o lote dividido em pedaços
+bool testarLote() {
+    RedeNeural rede(21, 2, 6);
+    ResultadoLote reaproveitado;
+    bool sucesso = true;
+
+    for(int amostras : {LOTE_MINIMO + 5, 1100, 1}) {
+        std::vector<double> inputs;
+        for(int i = 0; i < amostras * 21; i++) inputs.push_back(((i * 7) % 11) * 0.2 - 1.0);
+
+        ResultadoLote lote = rede.iniciarLote(inputs, amostras);
+        if(lote.saidas.size() != static_cast<size_t>(amostras * 6) || lote.valores.size() != lote.saidas.size()) {
+            std::cout << "Tamanho incorreto do resultado do lote: " << lote.saidas.size() << std::endl;
+            return false;
+        }
+
+        if(!rede.iniciarLote(inputs.data(), amostras, reaproveitado) || reaproveitado.valores != lote.valores ||
+           reaproveitado.saidas != lote.saidas) {
+            std::cout << "iniciarLote com resultado reaproveitado diferente com " << amostras << " amostras" << std::endl;
+            sucesso = false;
+        }
+
+        Rede estrutura = rede.getRede();
+        for(int i = 0; i < amostras; i++) {
+            std::vector<double> amostra(inputs.begin() + i * 21, inputs.begin() + (i + 1) * 21);
+            std::vector<double> referencia = calcularReferencia(estrutura, amostra);
+            std::vector<bool> resultado = rede.iniciar(amostra);
+            for(int n = 0; n < 6; n++) {
+                if(std::abs(lote.valores[i * 6 + n] - referencia[n]) > 1e-9 || lote.saidas[i * 6 + n] != resultado[n]) {
+                    std::cout << "Lote diferente de iniciar() na amostra " << i << ", saída " << n << std::endl;
+                    sucesso = false;
+                }
+            }
+        }
+    }
+
+    if(!rede.iniciarLote(std::vector<double>(10, 0.0), 1).saidas.empty()) {
+        std::cout << "iniciarLote aceitou um lote com tamanho errado" << std::endl;
+        sucesso = false;
+    }
+
+    return sucesso;
+}
+
+// Testa cada kernel SIMD disponível na CPU contra a versão escalar, dentro de uma tolerância
+bool testarKernels() {
+    const int neuronios = 11;
+    const int stride = 3 * LARGURA_SIMD;
+    VetorAlinhado pesos(neuronios * stride), bias(arredondarSimd(neuronios)), entrada(stride);
+    for(size_t i = 0; i < pesos.size(); i++) pesos[i] = ((i * 37) % 101) / 50.0 - 1.0;
+    for(size_t i = 0; i < bias.size(); i++) bias[i] = ((i * 13) % 7) / 3.5 - 1.0;
+    for(size_t i = 0; i < entrada.size(); i++) entrada[i] = ((i * 17) % 23) / 11.5 - 1.0;
+
+    const Kernels& escalar = kernelsEscalar();
+    VetorAlinhado esperado(arredondarSimd(neuronios)), obtido(arredondarSimd(neuronios));
+    bool sucesso = true;
+
+    for(const Kernels* kernels : kernelsDisponiveis()) {
+        double produtoEsperado = escalar.produtoEscalar(pesos.data(), entrada.data(), stride);
+        double produtoObtido = kernels->produtoEscalar(pesos.data(), entrada.data(), stride);
+        if(std::abs(produtoEsperado - produtoObtido) > 1e-9) {
+            std::cout << "Produto escalar " << kernels->nome << " diferente do escalar" << std::endl;
+            sucesso = false;
+        }
+
+        for(bool relu : {true, false}) {
+            escalar.camada(pesos.data(), bias.data(), entrada.data(), esperado.data(), neuronios, stride, relu);
+            kernels->camada(pesos.data(), bias.data(), entrada.data(), obtido.data(), neuronios, stride, relu);
+            for(int j = 0; j < neuronios; j++) {
+                if(std::abs(esperado[j] - obtido[j]) > 1e-9 || (relu && obtido[j] < 0)) {
+                    std::cout << "Camada " << kernels->nome << " diferente do escalar no neurônio " << j << std::endl;
+                    sucesso = false;
+                }
+            }
+        }
+
+        // Bloco 4 amostras x 4 neurônios, usando as 4 primeiras linhas dos pesos como amostras
+        double blocoEsperado[4 * 4] = {0}, blocoObtido[4 * 4] = {0};
+        escalar.bloco4x4(pesos.data(), stride, pesos.data() + 4 * stride, stride, blocoEsperado, 4, LARGURA_SIMD, stride);
+        kernels->bloco4x4(pesos.data(), stride, pesos.data() + 4 * stride, stride, blocoObtido, 4, LARGURA_SIMD, stride);
+        for(int j = 0; j < 16; j++) {
+            if(std::abs(blocoEsperado[j] - blocoObtido[j]) > 1e-9) {
+                std::cout << "Bloco 4x4 " << kernels->nome << " diferente do escalar na posição " << j << std::endl;
+                sucesso = false;
+            }
+        }
+
+        // Float e int8 com tamanhos múltiplos de 16 e 64; o int8 acumula em int32 e deve ser exato
+        std::vector<float, AlocadorAlinhado<float>> a(64), b(64);
+        std::vector<int8_t, AlocadorAlinhado<int8_t>> qa(128), qb(128);
+        for(size_t i = 0; i < a.size(); i++) a[i] = static_cast<float>(pesos[i]), b[i] = static_cast<float>(pesos[i + 64]);
+        for(size_t i = 0; i < qa.size(); i++) qa[i] = static_cast<int8_t>(static_cast<int>((i * 37) % 255) - 127), qb[i] = static_cast<int8_t>(static_cast<int>((i * 91) % 255) - 127);
+        if(std::abs(escalar.produtoEscalarFloat(a.data(), b.data(), 64) - kernels->produtoEscalarFloat(a.data(), b.data(), 64)) > 1e-4f ||
+           escalar.produtoEscalarInt8(qa.data(), qb.data(), 128) != kernels->produtoEscalarInt8(qa.data(), qb.data(), 128)) {
+            std::cout << "Produto escalar float/int8 " << kernels->nome << " diferente do escalar" << std::endl;
+            sucesso = false;
+        }
+
+        // Camada esparsa: linhas com tamanhos diferentes (uma vazia, algumas com 16 ou mais valores), comparada com a densa
+        // equivalente e com a versão escalar
+        VetorAlinhado valoresEsparsos, mascarada(pesos.size(), 0.0);
+        std::vector<int32_t, AlocadorAlinhado<int32_t>> colunas;
+        std::vector<uint32_t> linhas(1, 0);
+        for(int j = 0; j < neuronios; j++) {
+            for(int i = 0; i < stride && j != 5; i++) {
+                if((i + j) % (j % 4 + 1) != 0) continue;
+                valoresEsparsos.push_back(pesos[j * stride + i]);
+                colunas.push_back(i);
+                mascarada[j * stride + i] = pesos[j * stride + i];
+            }
+            while(valoresEsparsos.size() % LARGURA_SIMD != 0) {
+                valoresEsparsos.push_back(0.0);
+                colunas.push_back(0);
+            }
+            linhas.push_back(static_cast<uint32_t>(valoresEsparsos.size()));
+        }
+        VetorAlinhado densa(arredondarSimd(neuronios)), esparsa(arredondarSimd(neuronios));
+        for(bool relu : {false, true}) {
+            escalar.camada(mascarada.data(), bias.data(), entrada.data(), densa.data(), neuronios, stride, relu);
+            kernels->camadaEsparsa(valoresEsparsos.data(), colunas.data(), linhas.data(), bias.data(), entrada.data(),
+                                   esparsa.data(), neuronios, relu);
+            for(int j = 0; j < neuronios; j++) {
+                if(std::abs(densa[j] - esparsa[j]) > 1e-9) {
+                    std::cout << "Camada esparsa " << kernels->nome << " diferente da densa no neurônio " << j << std::endl;
+                    sucesso = false;
+                }
+            }
+        }
+
+        bool limiarEsperado[neuronios], limiarObtido[neuronios];
+        escalar.limiar(esperado.data(), limiarEsperado, neuronios);
+        kernels->limiar(esperado.data(), limiarObtido, neuronios);
+        for(int j = 0; j < neuronios; j++) {
+            if(limiarEsperado[j] != limiarObtido[j]) {
+                std::cout << "Limiar " << kernels->nome << " diferente do escalar na saída " << j << std::endl;
+                sucesso = false;
+            }
+        }
+    }
+
+    return sucesso;
+}
+
+// Testa a versão const de iniciar() com área de trabalho própria, com várias threads consultando a mesma rede
+bool testarIniciarReentrante() {
+    const RedeNeural rede(19, 3, 4);
+    Rede estrutura = rede.getRede();
+    const int numThreads = 4;
+    const int amostrasPorThread = 200;
+    std::vector<int> erros(numThreads, 0);
+
+    std::vector<std::thread> threads;
+    for(int t = 0; t < numThreads; t++) {
+        threads.emplace_back([&, t]() {
+            AreaTrabalho area = rede.criarAreaTrabalho();
+            double inputs[19];
+            bool saidas[4];
+            double valores[4];
+            for(int a = 0; a < amostrasPorThread; a++) {
+                for(int i = 0; i < 19; i++) inputs[i] = ((a * 31 + i * 7 + t) % 17) / 8.5 - 1.0;
+                if(!rede.iniciar(inputs, 19, saidas, area, valores)) {
+                    erros[t]++;
+                    continue;
+                }
+                std::vector<double> referencia = calcularReferencia(estrutura, std::vector<double>(inputs, inputs + 19));
+                for(int n = 0; n < 4; n++) {
+                    if(saidas[n] != (referencia[n] > 0) || std::abs(valores[n] - referencia[n]) > 1e-9) erros[t]++;
+                }
+            }
+        });
+    }
+    for(auto& thread : threads) thread.join();
+
+    bool sucesso = true;
+    for(int t = 0; t < numThreads; t++) {
+        if(erros[t] != 0) {
+            std::cout << "Thread " << t << " teve " << erros[t] << " saídas diferentes da referência" << std::endl;
+            sucesso = false;
+        }
+    }
+
+    // Entrada com tamanho errado e área de outra topologia menor devem ser recusadas
+    AreaTrabalho area = rede.criarAreaTrabalho();
+    AreaTrabalho areaPequena = RedeNeural(2, 1, 1).criarAreaTrabalho();
+    double inputs[19] = {0};
+    bool saidas[4];
+    if(rede.iniciar(inputs, 18, saidas, area) || rede.iniciar(inputs, 19, saidas, areaPequena)) {
+        std::cout << "iniciar aceitou entrada ou área de trabalho inválida" << std::endl;
+        sucesso = false;
+    }
+
+    return sucesso;
+}
+
+// Testa o forward paralelo por blocos de neurônios contra iniciar(), na RedeNeural e na VisaoRede, com 1, 3 e 4 threads
+bool testarIniciarParalelo() {
+    bool sucesso = true;
+    // 523 entradas: camadas ocultas de 523 x 528 pesos passam do limite e o último bloco fica incompleto; a saída fica sozinha
+    RedeNeural larga(523, 2, 10, 12), pequena(8, 1, 2, 13);
+    VisaoRede visao(larga.getLarguras(), larga.getParametros());
+    std::vector<double> inputs(523);
+    Xoshiro256 gerador(16);
+    gerador.preencherUniforme(inputs.data(), static_cast<int>(inputs.size()), -1.0, 1.0);
+
+    AreaTrabalho area = larga.criarAreaTrabalho(), areaParalela = larga.criarAreaTrabalho();
+    bool saidas[10], saidasParalelas[10];
+    double valores[10], valoresParalelos[10];
+    larga.iniciar(inputs.data(), inputs.size(), saidas, area, valores);
+
+    for(int numThreads : {1, 3, 4}) {
+        PoolTrabalho pool(numThreads);
+        for(int vez = 0; vez < 3; vez++) {
+            bool ok = vez < 2
+                ? larga.iniciarParalelo(inputs.data(), inputs.size(), saidasParalelas, areaParalela, pool, valoresParalelos)
+                : visao.iniciarParalelo(inputs.data(), inputs.size(), saidasParalelas, areaParalela, pool, valoresParalelos);
+            if(!ok || !std::equal(valores, valores + 10, valoresParalelos) || !std::equal(saidas, saidas + 10, saidasParalelas)) {
+                std::cout << "iniciarParalelo com " << numThreads << " threads diferente de iniciar()" << std::endl;
+                sucesso = false;
+            }
+        }
+
+        // Rede pequena fica na thread que chama e dá o mesmo resultado
+        AreaTrabalho areaPequena = pequena.criarAreaTrabalho();
+        bool saidaPequena[2], saidaPequenaParalela[2];
+        double valoresPequena[2], valoresPequenaParalela[2];
+        pequena.iniciar(inputs.data(), 8, saidaPequena, areaPequena, valoresPequena);
+        pequena.iniciarParalelo(inputs.data(), 8, saidaPequenaParalela, areaPequena, pool, valoresPequenaParalela);
+        if(!std::equal(valoresPequena, valoresPequena + 2, valoresPequenaParalela)) {
+            std::cout << "iniciarParalelo da rede pequena diferente de iniciar()" << std::endl;
+            sucesso = false;
+        }
+
+        AreaTrabalho areaVazia;
+        if(larga.iniciarParalelo(inputs.data(), 522, saidasParalelas, areaParalela, pool) ||
+           larga.iniciarParalelo(inputs.data(), inputs.size(), saidasParalelas, areaVazia, pool)) {
+            std::cout << "Entrada ou área inválida foi aceita em iniciarParalelo" << std::endl;
+            sucesso = false;
+        }
+    }
+    return sucesso;
+}
+
+// Testa o pool com roubo de trabalho: cada índice executado exatamente uma vez, mesmo com custos bem diferentes
+bool testarPoolTrabalho() {
+    PoolTrabalho pool(4);
+    std::vector<std::atomic<int>> execucoes(1000);
+    for(auto& e : execucoes) e = 0;
+
+    for(int rodada = 0; rodada < 3; rodada++) {
+        pool.paraCada(1000, [&](int indice, int thread) {
+            // Os primeiros índices custam muito mais, forçando as outras threads a roubar
+            volatile double lixo = 0;
+            for(int i = 0; i < (indice < 250 ? 20000 : 10); i++) lixo += i * thread;
+            execucoes[indice]++;
+        });
+    }
+
+    bool sucesso = true;
+    for(size_t i = 0; i < execucoes.size(); i++) {
+        if(execucoes[i] != 3) {
+            std::cout << "Índice " << i << " executado " << execucoes[i] << " vezes (esperado 3)" << std::endl;
+            sucesso = false;
+            break;
+        }
+    }
+
+    bool lancou = false;
+    try {
+        pool.paraCada(10, [](int indice, int) { if(indice == 7) throw std::runtime_error("erro"); });
+    } catch(const std::runtime_error&) {
+        lancou = true;
+    }
+    if(!lancou) {
+        std::cout << "Exceção da tarefa não chegou em paraCada" << std::endl;
+        sucesso = false;
+    }
+
+    return sucesso;
+}
+
+// Testa a neuroevolução: com elitismo a melhor aptidão nunca piora e a população mantém o tamanho
+bool testarNeuroevolucao() {
+    // Aprender se a soma das entradas é positiva
+    std::vector<std::vector<double>> amostras;
+    for(int i = 0; i < 40; i++) {
+        amostras.push_back({((i * 7) % 13) / 6.5 - 1.0, ((i * 5) % 11) / 5.5 - 1.0, ((i * 3) % 7) / 3.5 - 1.0});
+    }
+    FuncaoAptidao aptidao = [&](const RedeNeural& rede, AreaTrabalho& area) {
+        double acertos = 0;
+        bool saida[1];
+        for(const auto& amostra : amostras) {
+            rede.iniciar(amostra.data(), amostra.size(), saida, area);
+            bool esperado = amostra[0] + amostra[1] + amostra[2] > 0;
+            if(saida[0] == esperado) acertos++;
+        }
+        return acertos / amostras.size();
+    };
+
+    ConfiguracaoEvolucao config;
+    config.tamanhoPopulacao = 40;
+    config.numElite = 5;
+    config.numThreads = 3;
+    Neuroevolucao evolucao(3, 1, 1, config, aptidao);
+    std::vector<EstatisticasGeracao> historico = evolucao.evoluir(15);
+
+    bool sucesso = true;
+    for(size_t g = 1; g < historico.size(); g++) {
+        if(historico[g].melhorAptidao < historico[g - 1].melhorAptidao) {
+            std::cout << "Melhor aptidão piorou na geração " << g << std::endl;
+            sucesso = false;
+        }
+    }
+    if(evolucao.getPopulacao().size() != 40 || historico.back().individuosPorSegundo <= 0) {
+        std::cout << "População ou estatísticas incorretas" << std::endl;
+        sucesso = false;
+    }
+    // Mesma semente com outro número de threads: mesmo resultado
+    config.semente = 1234;
+    Neuroevolucao tresThreads(3, 1, 1, config, aptidao);
+    config.numThreads = 1;
+    Neuroevolucao umaThread(3, 1, 1, config, aptidao);
+    umaThread.evoluir(5);
+    tresThreads.evoluir(5);
+    std::size_t tamanho = umaThread.getMelhor().getCamadas().back().offsetBias + 1;
+    if(!std::equal(umaThread.getMelhor().getParametros(), umaThread.getMelhor().getParametros() + tamanho,
+                   tresThreads.getMelhor().getParametros())) {
+        std::cout << "Mesma semente deu resultados diferentes com número de threads diferente" << std::endl;
+        sucesso = false;
+    }
+
+    AreaTrabalho area = evolucao.getMelhor().criarAreaTrabalho();
+    if(aptidao(evolucao.getMelhor(), area) != historico.back().melhorAptidao) {
+        std::cout << "getMelhor() não é o melhor indivíduo avaliado" << std::endl;
+        sucesso = false;
+    }
+
+    return sucesso;
+}
+
+// Testa o gerador semeável: mesma semente dá a mesma rede e as mesmas mutações, e a taxa de mutação é respeitada
+bool testarGeradorSemeavel() {
+    bool sucesso = true;
+
+    RedeNeural a(9, 2, 3, 42), b(9, 2, 3, 42), c(9, 2, 3, 43);
+    std::size_t tamanho = a.getCamadas().back().offsetBias + arredondarSimd(3);
+    if(!std::equal(a.getParametros(), a.getParametros() + tamanho, b.getParametros())) {
+        std::cout << "Mesma semente gerou redes diferentes" << std::endl;
+        sucesso = false;
+    }
+    if(std::equal(a.getParametros(), a.getParametros() + tamanho, c.getParametros())) {
+        std::cout << "Sementes diferentes geraram a mesma rede" << std::endl;
+        sucesso = false;
+    }
+
+    Xoshiro256 geradorA(7), geradorB(7);
+    a.modificarPesos(0.1, 0.3, geradorA);
+    b.modificarPesos(0.1, 0.3, geradorB);
+    if(!std::equal(a.getParametros(), a.getParametros() + tamanho, b.getParametros())) {
+        std::cout << "Mesma semente gerou mutações diferentes" << std::endl;
+        sucesso = false;
+    }
+
+    semearGeradorDaThread(99);
+    RedeNeural d(9, 2, 3);
+    semearGeradorDaThread(99);
+    RedeNeural e(9, 2, 3);
+    if(!std::equal(d.getParametros(), d.getParametros() + tamanho, e.getParametros())) {
+        std::cout << "Gerador da thread semeado não reproduziu a rede" << std::endl;
+        sucesso = false;
+    }
+
+    // Taxa 0 não muda nada, taxa 1 muda todos os pesos, taxa 0.1 muda perto de 10%
+    for(double taxa : {0.0, 1.0, 0.1}) {
+        RedeNeural grande(60, 3, 10, 5);
+        Rede antes = grande.getRede();
+        grande.modificarPesos(0.01, taxa);
+        Rede depois = grande.getRede();
+        int alterados = 0, total = 0;
+        for(size_t l = 1; l < antes.layers.size(); l++) {
+            for(size_t n = 0; n < antes.layers[l].neuronios.size(); n++) {
+                for(size_t p = 0; p < antes.layers[l].neuronios[n].pesos.size(); p++) {
+                    total++;
+                    if(antes.layers[l].neuronios[n].pesos[p] != depois.layers[l].neuronios[n].pesos[p]) alterados++;
+                }
+            }
+        }
+        double fracao = static_cast<double>(alterados) / total;
+        // Pesos já em ±1 podem ficar iguais depois do limite, por isso a folga na taxa 1
+        if(std::abs(fracao - taxa) > (taxa == 0.0 ? 0.0 : 0.03)) {
+            std::cout << "Taxa de mutação " << taxa << " alterou " << fracao << " dos pesos" << std::endl;
+            sucesso = false;
+        }
+    }
+
+    return sucesso;
+}
+
+// Testa o truncamento sem cópias, ponderado, em paralelo e pelo acumulador, contra o truncamento por Rede
+bool testarTruncamentoSemCopia() {
+    bool sucesso = true;
+    std::vector<RedeNeural> populacao;
+    std::vector<Rede> estruturas;
+    std::vector<const RedeNeural*> ponteiros;
+    for(int i = 0; i < 7; i++) {
+        populacao.push_back(RedeNeural(70, 2, 9, 100 + i));  // Mais de um bloco de soma
+    }
+    for(const auto& rede : populacao) {
+        estruturas.push_back(rede.getRede());
+        ponteiros.push_back(&rede);
+    }
+
+    RedeNeural referencia(70, 2, 9);
+    referencia.setRede(referencia.truncamento(estruturas));
+
+    PoolTrabalho pool(3);
+    RedeNeural sequencial(70, 2, 9), paralelo(70, 2, 9), acumulado(70, 2, 9);
+    sequencial.truncamento(ponteiros.data(), ponteiros.size());
+    paralelo.truncamento(ponteiros.data(), ponteiros.size(), nullptr, &pool);
+
+    AcumuladorTruncamento acumulador(populacao[0]);
+    for(const auto& rede : populacao) acumulador.adicionar(rede);
+    acumulador.resultado(acumulado);
+
+    for(std::size_t i = 0; i < referencia.getNumParametros(); i++) {
+        double esperado = referencia.getParametros()[i];
+        if(std::abs(sequencial.getParametros()[i] - esperado) > 1e-12 ||
+           std::abs(paralelo.getParametros()[i] - esperado) > 1e-12 ||
+           std::abs(acumulado.getParametros()[i] - esperado) > 1e-12) {
+            std::cout << "Truncamento sem cópia diferente da referência no parâmetro " << i << std::endl;
+            sucesso = false;
+            break;
+        }
+    }
+
+    // Ponderado: só a rede 2 tem peso, a média é ela mesma
+    std::vector<double> aptidoes(7, 0.0);
+    aptidoes[2] = 3.0;
+    RedeNeural ponderada(70, 2, 9);
+    ponderada.truncamento(ponteiros.data(), ponteiros.size(), aptidoes.data(), &pool);
+    if(!std::equal(ponderada.getParametros(), ponderada.getParametros() + ponderada.getNumParametros(), populacao[2].getParametros())) {
+        std::cout << "Truncamento ponderado não respeitou os pesos" << std::endl;
+        sucesso = false;
+    }
+
+    // Topologia diferente e pesos negativos são recusados
+    RedeNeural outra(5, 1, 2);
+    aptidoes[0] = -1.0;
+    if(outra.truncamento(ponteiros.data(), ponteiros.size()) || ponderada.truncamento(ponteiros.data(), ponteiros.size(), aptidoes.data()) ||
+       acumulador.adicionar(outra)) {
+        std::cout << "Truncamento aceitou topologia diferente ou peso negativo" << std::endl;
+        sucesso = false;
+    }
+
+    return sucesso;
+}
+
+// Testa o formato binário: várias redes em um arquivo, inferência direto do mmap e recusa de arquivo corrompido
+bool testarModeloBinario() {
+    const std::string caminho = "teste_rede_modelo.bin";
+    RedeNeural a(5, 2, 3, 1), b(17, 1, 2, 2), c(8, 0, 9, 3);
+    std::vector<const RedeNeural*> redes = {&a, &b, &c};
+    bool sucesso = true;
+
+    if(!salvarModelo(caminho, redes)) {
+        std::cout << "Não foi possível salvar o modelo" << std::endl;
+        return false;
+    }
+
+    {
+        ModeloMapeado modelo;
+        if(!modelo.abrir(caminho) || modelo.getNumRedes() != 3) {
+            std::cout << "Não foi possível abrir o modelo: " << modelo.getErro() << std::endl;
+            std::remove(caminho.c_str());
+            return false;
+        }
+
+        for(size_t r = 0; r < redes.size(); r++) {
+            const VisaoRede& visao = modelo.getRede(r);
+            if(reinterpret_cast<uintptr_t>(visao.getParametros()) % ALINHAMENTO != 0 ||
+               !std::equal(redes[r]->getParametros(), redes[r]->getParametros() + redes[r]->getNumParametros(), visao.getParametros())) {
+                std::cout << "Parâmetros mapeados da rede " << r << " diferentes ou desalinhados" << std::endl;
+                sucesso = false;
+                continue;
+            }
+
+            std::vector<double> inputs(visao.getEntrada());
+            for(size_t i = 0; i < inputs.size(); i++) inputs[i] = (i % 3) * 0.5 - 0.5;
+            AreaTrabalho areaVisao = visao.criarAreaTrabalho(), areaRede = redes[r]->criarAreaTrabalho();
+            bool saidaVisao[9], saidaRede[9];
+            double valoresVisao[9], valoresRede[9];
+            visao.iniciar(inputs.data(), inputs.size(), saidaVisao, areaVisao, valoresVisao);
+            redes[r]->iniciar(inputs.data(), inputs.size(), saidaRede, areaRede, valoresRede);
+            for(int n = 0; n < visao.getSaida(); n++) {
+                if(saidaVisao[n] != saidaRede[n] || valoresVisao[n] != valoresRede[n]) {
+                    std::cout << "Saída da rede mapeada " << r << " diferente da original" << std::endl;
+                    sucesso = false;
+                }
+            }
+        }
+    }
+
+    RedeNeural carregada(1, 0, 1);
+    if(!carregarModelo(caminho, carregada, 1) || !carregada.mesmaTopologia(b) ||
+       !std::equal(b.getParametros(), b.getParametros() + b.getNumParametros(), carregada.getParametros())) {
+        std::cout << "carregarModelo não reproduziu a rede" << std::endl;
+        sucesso = false;
+    }
+
+    // Offset das larguras perto de 2^64 não pode estourar a verificação e ler fora do mapeamento
+    {
+        std::fstream arquivo(caminho.c_str(), std::ios::binary | std::ios::in | std::ios::out);
+        uint64_t offsetInvalido = UINT64_MAX - 3;
+        arquivo.seekp(sizeof(CabecalhoModelo) + offsetof(EntradaModelo, offsetLarguras));
+        arquivo.write(reinterpret_cast<const char*>(&offsetInvalido), sizeof(offsetInvalido));
+    }
+    ModeloMapeado corrompido;
+    if(corrompido.abrir(caminho)) {
+        std::cout << "Modelo com offset de larguras inválido foi aceito" << std::endl;
+        sucesso = false;
+    }
+
+    // Larguras que fazem a contagem de parâmetros dar a volta em size_t até 0: 65536 layers de 2^24 e mais três
+    {
+        std::vector<uint32_t> larguras(65536, 1u << 24);
+        larguras.push_back(16711664);
+        larguras.push_back(8);
+        larguras.push_back(14978632);
+        const uint64_t offsetLarguras = sizeof(CabecalhoModelo) + sizeof(EntradaModelo);
+        const uint64_t fimLarguras = offsetLarguras + larguras.size() * sizeof(uint32_t);
+        const uint64_t offsetParametros = (fimLarguras + ALINHAMENTO - 1) / ALINHAMENTO * ALINHAMENTO;
+
+        CabecalhoModelo cabecalho = {};
+        std::memcpy(cabecalho.magica, "REDENEUR", sizeof(cabecalho.magica));
+        cabecalho.versao = VERSAO_MODELO;
+        cabecalho.marcaEndian = MARCA_ENDIAN;
+        cabecalho.larguraSimd = LARGURA_SIMD;
+        cabecalho.bytesValor = sizeof(double);
+        cabecalho.numRedes = 1;
+        cabecalho.tamanhoArquivo = offsetParametros;
+        EntradaModelo entrada = {};
+        entrada.offsetLarguras = offsetLarguras;
+        entrada.offsetParametros = offsetParametros;
+        entrada.numParametros = 0;
+        entrada.numLarguras = static_cast<uint32_t>(larguras.size());
+
+        std::ofstream saida(caminho.c_str(), std::ios::binary | std::ios::trunc);
+        saida.write(reinterpret_cast<const char*>(&cabecalho), sizeof(cabecalho));
+        saida.write(reinterpret_cast<const char*>(&entrada), sizeof(entrada));
+        saida.write(reinterpret_cast<const char*>(larguras.data()), larguras.size() * sizeof(uint32_t));
+        std::vector<char> preenchimento(offsetParametros - fimLarguras, 0);
+        saida.write(preenchimento.data(), preenchimento.size());
+    }
+    ModeloMapeado estourado;
+    if(estourado.abrir(caminho)) {
+        std::cout << "Modelo com contagem de parâmetros estourada foi aceito" << std::endl;
+        sucesso = false;
+    }
+    if(!salvarModelo(caminho, redes)) {
+        std::cout << "Não foi possível salvar o modelo" << std::endl;
+        sucesso = false;
+    }
+
+    // Arquivo cortado no meio deve ser recusado
+    {
+        std::ifstream entrada(caminho.c_str(), std::ios::binary);
+        std::string conteudo((std::istreambuf_iterator<char>(entrada)), std::istreambuf_iterator<char>());
+        std::ofstream saida(caminho.c_str(), std::ios::binary | std::ios::trunc);
+        saida.write(conteudo.data(), conteudo.size() / 2);
+    }
+    ModeloMapeado cortado;
+    if(cortado.abrir(caminho) || carregarModelo(caminho, carregada)) {
+        std::cout << "Modelo truncado foi aceito" << std::endl;
+        sucesso = false;
+    }
+
+    std::remove(caminho.c_str());
+    return sucesso;
+}
+
+// Testa a conversão para float e int8: memória menor e saídas que concordam com a rede double
+bool testarRedeReduzida() {
+    const int entrada = 40, saida = 6, amostras = 500;
+    RedeNeural rede(entrada, 2, saida, 11);
+    RedeFloat redeFloat(rede);
+    RedeInt8 redeInt8(rede);
+    bool sucesso = true;
+
+    if(redeFloat.getBytesPesos() >= rede.getNumParametros() * sizeof(double) ||
+       redeInt8.getBytesPesos() >= redeFloat.getBytesPesos()) {
+        std::cout << "Pesos reduzidos não ocupam menos memória" << std::endl;
+        sucesso = false;
+    }
+
+    std::vector<double> inputs(static_cast<size_t>(amostras) * entrada);
+    Xoshiro256 gerador(5);
+    gerador.preencherUniforme(inputs.data(), static_cast<int>(inputs.size()), -1.0, 1.0);
+
+    RelatorioConcordancia relatorioFloat = compararConcordancia(rede, redeFloat, inputs, amostras);
+    RelatorioConcordancia relatorioInt8 = compararConcordancia(rede, redeInt8, inputs, amostras);
+    if(relatorioFloat.amostras != static_cast<size_t>(amostras) || relatorioFloat.discordanciaPorSaida.size() != static_cast<size_t>(saida) ||
+       relatorioInt8.discordanciaPorSaida.size() != static_cast<size_t>(saida)) {
+        std::cout << "Relatório de concordância incompleto" << std::endl;
+        return false;
+    }
+    if(relatorioFloat.discordanciaTotal > 0.01 || relatorioFloat.erroMaximo > 1e-3) {
+        std::cout << "Rede float discorda em " << relatorioFloat.discordanciaTotal * 100 << "% das saídas" << std::endl;
+        sucesso = false;
+    }
+    if(relatorioInt8.discordanciaTotal > 0.1) {
+        std::cout << "Rede int8 discorda em " << relatorioInt8.discordanciaTotal * 100 << "% das saídas" << std::endl;
+        sucesso = false;
+    }
+
+    AreaReduzida area = redeInt8.criarAreaTrabalho();
+    bool saidas[saida];
+    if(redeInt8.iniciar(inputs.data(), entrada - 1, saidas, area)) {
+        std::cout << "Entrada de tamanho errado foi aceita" << std::endl;
+        sucesso = false;
+    }
+
+    return sucesso;
+}
+
+// Testa a poda por magnitude: camadas densas e esparsas dão o mesmo resultado que a RedeNeural com os mesmos pesos zerados
+bool testarRedePodada() {
+    const int entrada = 45, saida = 6, amostras = 300;
+    RedeNeural rede(entrada, 2, saida, 21);
+    std::vector<double> inputs(static_cast<size_t>(amostras) * entrada);
+    Xoshiro256 gerador(9);
+    gerador.preencherUniforme(inputs.data(), static_cast<int>(inputs.size()), -1.0, 1.0);
+    bool sucesso = true;
+
+    std::size_t totalPesos = 0;
+    for(const auto& camada : rede.getCamadas()) totalPesos += static_cast<std::size_t>(camada.entradas) * camada.neuronios;
+
+    // Compara a rede podada com a RedeNeural que recebeu os pesos podados por copiarPara()
+    auto conferir = [&](const RedePodada& podada, const char* nome) {
+        RedeNeural densa(1, 0, 1);
+        podada.copiarPara(densa);
+        AreaTrabalho area = podada.criarAreaTrabalho(), areaDensa = densa.criarAreaTrabalho();
+        for(int a = 0; a < amostras; a++) {
+            bool saidas[saida], saidasDensa[saida];
+            double valores[saida], valoresDensa[saida];
+            const double* amostra = inputs.data() + static_cast<size_t>(a) * entrada;
+            if(!podada.iniciar(amostra, entrada, saidas, area, valores) ||
+               !densa.iniciar(amostra, entrada, saidasDensa, areaDensa, valoresDensa)) {
+                std::cout << "iniciar da rede podada (" << nome << ") falhou" << std::endl;
+                return false;
+            }
+            for(int n = 0; n < saida; n++) {
+                if(std::abs(valores[n] - valoresDensa[n]) > 1e-9) {
+                    std::cout << "Rede podada (" << nome << ") diferente da densa equivalente na amostra " << a << std::endl;
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+
+    // Esparsidade alvo: remove exatamente a fração pedida, nas três escolhas de representação
+    ConfiguracaoPoda config;
+    config.criterio = PODA_ESPARSIDADE;
+    config.esparsidade = 0.7;
+    config.densidadeMaxima = 1.0;
+    RedePodada esparsa(rede, config);
+    config.densidadeMaxima = 0.0;
+    RedePodada densa(rede, config);
+    config.densidadeMaxima = -1.0;
+    RedePodada automatica(rede, config);
+
+    const double esperada = static_cast<double>(static_cast<std::size_t>(0.7 * totalPesos)) / totalPesos;
+    if(esparsa.getEsparsidade() != esperada || densa.getEsparsidade() != esperada) {
+        std::cout << "Esparsidade " << esparsa.getEsparsidade() << ", esperado " << esperada << std::endl;
+        sucesso = false;
+    }
+    for(const auto& camada : esparsa.getCamadas()) {
+        if(!camada.esparsa || camada.densidade > 0.5) {
+            std::cout << "Camada não ficou em CSR com densidadeMaxima 1" << std::endl;
+            sucesso = false;
+        }
+    }
+    for(const auto& camada : densa.getCamadas()) {
+        if(camada.esparsa) {
+            std::cout << "Camada ficou em CSR com densidadeMaxima 0" << std::endl;
+            sucesso = false;
+        }
+    }
+    if(esparsa.getBytesPesos() >= densa.getBytesPesos()) {
+        std::cout << "CSR com 30% dos pesos não ocupa menos memória" << std::endl;
+        sucesso = false;
+    }
+    sucesso = conferir(esparsa, "CSR") && sucesso;
+    sucesso = conferir(densa, "densa") && sucesso;
+    sucesso = conferir(automatica, "automática") && sucesso;
+
+    // Limiar: pesos uniformes em [-1, 1], |w| <= 0.5 é metade deles
+    config.criterio = PODA_LIMIAR;
+    config.limiar = 0.5;
+    RedePodada porLimiar(rede, config);
+    if(std::abs(porLimiar.getEsparsidade() - 0.5) > 0.05) {
+        std::cout << "Poda por limiar removeu " << porLimiar.getEsparsidade() * 100 << "% dos pesos" << std::endl;
+        sucesso = false;
+    }
+    sucesso = conferir(porLimiar, "limiar") && sucesso;
+
+    // Sem poda a concordância é total; com poda o relatório fica completo
+    config.limiar = -1.0;
+    RedePodada semPoda(rede, config);
+    RelatorioConcordancia relatorioSemPoda = compararConcordancia(rede, semPoda, inputs, amostras);
+    RelatorioConcordancia relatorio = compararConcordancia(rede, esparsa, inputs, amostras);
+    if(semPoda.getEsparsidade() != 0.0 || relatorioSemPoda.discordanciaTotal != 0.0 || relatorioSemPoda.erroMaximo > 1e-9 ||
+       relatorio.amostras != static_cast<size_t>(amostras) || relatorio.discordanciaPorSaida.size() != static_cast<size_t>(saida) ||
+       relatorio.erroMaximo <= 0.0) {
+        std::cout << "Relatório de concordância da poda inconsistente" << std::endl;
+        sucesso = false;
+    }
+
+    AreaTrabalho area = esparsa.criarAreaTrabalho(), pequena;
+    bool saidas[saida];
+    if(esparsa.iniciar(inputs.data(), entrada - 1, saidas, area) || esparsa.iniciar(inputs.data(), entrada, saidas, pequena)) {
+        std::cout << "Entrada ou área inválida foi aceita" << std::endl;
+        sucesso = false;
+    }
+    return sucesso;
+}
+
+// Testa a rede de topologia fixa: mesmo layout, mesmos pesos e mesmas saídas da RedeNeural, e conversão de ida e volta
+template<int Entrada, int NumLayers, int Saida>
+bool testarTopologiaEstatica(uint64_t semente) {
+    RedeNeural dinamica(Entrada, NumLayers, Saida, semente);
+    RedeNeuralEstatica<Entrada, NumLayers, Saida> estatica(semente);
+    if(RedeNeuralEstatica<Entrada, NumLayers, Saida>::NUM_PARAMETROS != dinamica.getNumParametros() ||
+       !std::equal(dinamica.getParametros(), dinamica.getParametros() + dinamica.getNumParametros(), estatica.getParametros())) {
+        std::cout << "Rede estática com pesos diferentes da dinâmica" << std::endl;
+        return false;
+    }
+
+    bool sucesso = true;
+    AreaTrabalho area = dinamica.criarAreaTrabalho();
+    std::vector<double> inputs(Entrada);
+    for(int amostra = 0; amostra < 20; amostra++) {
+        for(int i = 0; i < Entrada; i++) inputs[i] = ((amostra * 7 + i * 3) % 11) / 5.0 - 1.0;
+        bool saidaDinamica[Saida], saidaEstatica[Saida];
+        double valoresDinamica[Saida], valoresEstatica[Saida];
+        dinamica.iniciar(inputs.data(), inputs.size(), saidaDinamica, area, valoresDinamica);
+        estatica.iniciar(inputs.data(), saidaEstatica, valoresEstatica);
+        for(int n = 0; n < Saida; n++) {
+            if(saidaDinamica[n] != saidaEstatica[n] || std::abs(valoresDinamica[n] - valoresEstatica[n]) > 1e-9) {
+                std::cout << "Saída da rede estática diferente na amostra " << amostra << std::endl;
+                sucesso = false;
+            }
+        }
+    }
+
+    // Ida e volta pela Rede
+    RedeNeuralEstatica<Entrada, NumLayers, Saida> copia;
+    if(!copia.setRede(estatica.getRede()) ||
+       !std::equal(estatica.getParametros(), estatica.getParametros() + dinamica.getNumParametros(), copia.getParametros()) ||
+       !estatica.getRedeNeural().mesmaTopologia(dinamica)) {
+        std::cout << "Conversão da rede estática não reproduziu os pesos" << std::endl;
+        sucesso = false;
+    }
+    return sucesso;
+}
+
+bool testarRedeEstatica() {
+    bool sucesso = testarTopologiaEstatica<5, 2, 3>(7) && testarTopologiaEstatica<3, 0, 12>(8) &&
+                   testarTopologiaEstatica<17, 1, 2>(9);
+
+    RedeNeuralEstatica<4, 1, 2> pequena(3);
+    std::array<double, 4> inputs = {{0.5, -0.25, 1.0, 0.0}};
+    std::array<bool, 2> saidas = pequena.iniciar(inputs);
+    RedeNeural referencia(4, 1, 2, 3);
+    if(referencia.iniciar(std::vector<double>(inputs.begin(), inputs.end())) != std::vector<bool>(saidas.begin(), saidas.end())) {
+        std::cout << "iniciar() com std::array diferente da RedeNeural" << std::endl;
+        sucesso = false;
+    }
+
+    // Topologia diferente deve ser recusada
+    if(pequena.setRede(RedeNeural(4, 2, 2)) || pequena.setRede(RedeNeural(5, 1, 2).getRede())) {
+        std::cout << "Rede de outra topologia foi aceita" << std::endl;
+        sucesso = false;
+    }
+
+    // Conversões de e para RedeNeural não podem avançar o gerador da thread semeado pelo usuário
+    semearGeradorDaThread(21);
+    Xoshiro256 esperado = geradorDaThread();
+    RedeNeural convertida = pequena.getRedeNeural();
+    if(!pequena.setRede(pequena.getRede()) || !pequena.setRede(convertida) ||
+       geradorDaThread().proximo() != esperado.proximo()) {
+        std::cout << "getRedeNeural()/setRede() alteraram o gerador da thread" << std::endl;
+        sucesso = false;
+    }
+    return sucesso;
+}
+
+// Testa a instrumentação: com REDENEURAL_INSTRUMENTACAO conta chamadas, camadas e alocações; sem ela o retrato fica vazio
+bool testarInstrumentacao() {
+    zerarInstrumentacao();
+    RedeNeural rede(6, 2, 3, 4);
+    AreaTrabalho area = rede.criarAreaTrabalho();
+    double inputs[6] = {0.1, -0.2, 0.3, -0.4, 0.5, -0.6};
+    bool saidas[3];
+    const int chamadas = 50;
+    for(int i = 0; i < chamadas; i++) {
+        rede.iniciar(inputs, 6, saidas, area);
+    }
+    Xoshiro256 gerador(1);
+    rede.modificarPesos(0.1, 0.5, gerador);
+    const RedeNeural* redes[1] = {&rede};
+    rede.truncamento(redes, 1);
+
+    RetratoInstrumentacao retrato = retratoInstrumentacao();
+    std::string texto = exportarPrometheus(retrato);
+#ifdef REDENEURAL_INSTRUMENTACAO
+    EstatisticasThread total = retrato.total();
+    if(!retrato.ativa || retrato.threads.empty() || total.chamadas[OPERACAO_INICIAR] != static_cast<uint64_t>(chamadas) ||
+       total.tempos[OPERACAO_INICIAR].quantidade != static_cast<uint64_t>(chamadas) ||
+       total.camadas[0].quantidade != static_cast<uint64_t>(chamadas) || total.camadas[2].quantidade != static_cast<uint64_t>(chamadas) ||
+       total.camadas[3].quantidade != 0 || total.chamadas[OPERACAO_MODIFICAR_PESOS] != 1 ||
+       total.chamadas[OPERACAO_TRUNCAMENTO] != 1 || total.alocacoes == 0) {
+        std::cout << "Contadores da instrumentação não batem com as chamadas" << std::endl;
+        return false;
+    }
+    if(texto.find("redeneural_chamadas_total{operacao=\"iniciar\",thread=") == std::string::npos ||
+       texto.find("redeneural_camada_duracao_segundos_count{camada=\"2\"} 50") == std::string::npos ||
+       texto.find("le=\"+Inf\"") == std::string::npos) {
+        std::cout << "Texto Prometheus incompleto" << std::endl;
+        return false;
+    }
+    zerarInstrumentacao();
+    if(retratoInstrumentacao().total().chamadas[OPERACAO_INICIAR] != 0) {
+        std::cout << "zerarInstrumentacao() não zerou os contadores" << std::endl;
+        return false;
+    }
+#else
+    if(retrato.ativa || !retrato.threads.empty() || texto.find("redeneural_instrumentacao_ativa 0") == std::string::npos) {
+        std::cout << "Retrato não está vazio com a instrumentação desligada" << std::endl;
+        return false;
+    }
+#endif
+    return true;
+}
+
+// Testa a retropropagação contra diferenças finitas, a independência do número de threads e a convergência com SGD e Adam
+bool testarTreinamento() {
+    bool sucesso = true;
+    const int amostrasGradiente = 6;
+    std::vector<double> inputs(amostrasGradiente * 3), alvos(amostrasGradiente * 2);
+    Xoshiro256 gerador(21);
+    gerador.preencherUniforme(inputs.data(), static_cast<int>(inputs.size()), -1.0, 1.0);
+    for(size_t i = 0; i < alvos.size(); i++) alvos[i] = (i % 3) == 0 ? 1.0 : 0.0;
+
+    for(FuncaoPerda perda : {PERDA_QUADRATICA, PERDA_LOGISTICA}) {
+        RedeNeural rede(3, 2, 2, 13);
+        ConfiguracaoTreinamento config;
+        config.perda = perda;
+        Treinador treinador(rede, config);
+        treinador.calcularGradiente(inputs.data(), alvos.data(), amostrasGradiente);
+        std::vector<double> gradiente(treinador.getGradiente(), treinador.getGradiente() + rede.getNumParametros());
+
+        // Derivada numérica de cada peso e bias, mexendo na Rede e medindo a perda
+        const Rede original = rede.getRede();
+        const double h = 1e-6;
+        for(size_t c = 0; c < rede.getCamadas().size(); c++) {
+            const CamadaDensa camada = rede.getCamadas()[c];
+            for(int n = 0; n < camada.neuronios; n++) {
+                for(int p = 0; p <= camada.entradas; p++) {
+                    Rede alterada = original;
+                    alterada.layers[c + 1].neuronios[n].pesos[p] += h;
+                    rede.setRede(alterada);
+                    double mais = treinador.calcularPerda(inputs, alvos, amostrasGradiente);
+                    alterada.layers[c + 1].neuronios[n].pesos[p] -= 2 * h;
+                    rede.setRede(alterada);
+                    double menos = treinador.calcularPerda(inputs, alvos, amostrasGradiente);
+
+                    std::size_t indice = p == camada.entradas ? camada.offsetBias + n
+                                                              : camada.offsetPesos + static_cast<std::size_t>(n) * camada.stride + p;
+                    double numerica = (mais - menos) / (2 * h);
+                    if(std::abs(numerica - gradiente[indice]) > 1e-5 * std::max(1.0, std::abs(numerica))) {
+                        std::cout << "Gradiente da camada " << c << " neurônio " << n << " peso " << p << ": "
+                                  << gradiente[indice] << " esperado " << numerica << std::endl;
+                        sucesso = false;
+                    }
+                }
+            }
+        }
+        rede.setRede(original);
+
+        // Com 3 threads o lote é dividido em 3 partes, o gradiente médio é o mesmo
+        ConfiguracaoTreinamento configThreads = config;
+        configThreads.numThreads = 3;
+        Treinador paralelo(rede, configThreads);
+        paralelo.calcularGradiente(inputs.data(), alvos.data(), amostrasGradiente);
+        for(size_t i = 0; i < gradiente.size(); i++) {
+            if(std::abs(paralelo.getGradiente()[i] - gradiente[i]) > 1e-12) {
+                std::cout << "Gradiente com 3 threads diferente na posição " << i << std::endl;
+                sucesso = false;
+                break;
+            }
+        }
+    }
+
+    // Problema separável: saída 0 = x0 + x1 > 0, saída 1 = x2 - x3 > 0.2
+    const int amostras = 512;
+    std::vector<double> treinoInputs(amostras * 4), treinoAlvos(amostras * 2);
+    gerador.preencherUniforme(treinoInputs.data(), static_cast<int>(treinoInputs.size()), -1.0, 1.0);
+    for(int a = 0; a < amostras; a++) {
+        const double* x = &treinoInputs[a * 4];
+        treinoAlvos[a * 2] = x[0] + x[1] > 0 ? 1.0 : 0.0;
+        treinoAlvos[a * 2 + 1] = x[2] - x[3] > 0.2 ? 1.0 : 0.0;
+    }
+
+    for(TipoOtimizador otimizador : {OTIMIZADOR_SGD, OTIMIZADOR_ADAM}) {
+        RedeNeural rede(4, 1, 2, 17);
+        ConfiguracaoTreinamento config;
+        config.otimizador = otimizador;
+        config.taxaAprendizado = otimizador == OTIMIZADOR_SGD ? 0.05 : 0.01;
+        config.momento = 0.9;
+        config.semente = 3;
+        config.numThreads = 2;
+        Treinador treinador(rede, config);
+
+        double perdaInicial = treinador.calcularPerda(treinoInputs, treinoAlvos, amostras);
+        for(int epoca = 0; epoca < 40; epoca++) {
+            treinador.treinarEpoca(treinoInputs, treinoAlvos, amostras);
+        }
+        double perdaFinal = treinador.calcularPerda(treinoInputs, treinoAlvos, amostras);
+
+        int acertos = 0;
+        AreaTrabalho area = rede.criarAreaTrabalho();
+        bool saidas[2];
+        for(int a = 0; a < amostras; a++) {
+            rede.iniciar(&treinoInputs[a * 4], 4, saidas, area);
+            acertos += (saidas[0] == (treinoAlvos[a * 2] > 0.5)) + (saidas[1] == (treinoAlvos[a * 2 + 1] > 0.5));
+        }
+        double acuracia = acertos / (2.0 * amostras);
+        if(perdaFinal > perdaInicial * 0.5 || acuracia < 0.95) {
+            std::cout << (otimizador == OTIMIZADOR_SGD ? "SGD" : "Adam") << ": perda " << perdaInicial << " -> " << perdaFinal
+                      << ", acurácia " << acuracia << std::endl;
+            sucesso = false;
+        }
+    }
+
+    return sucesso;
+}
+
+// Testa as redes compartilhadas: clones sem cópia, mutação igual à modificarPesos() guardada como diferenças e reuso da arena
+bool testarRedeCompartilhada() {
+    bool sucesso = true;
+    RedeNeural original(20, 2, 5, 31);
+    ArenaPesos arena(1 << 16);
+    RedeCompartilhada pai(original, arena);
+
+    std::vector<RedeCompartilhada> populacao(1000, pai);
+    if(arena.getBlocosEmUso() != 1 || !populacao[999].compartilhaBase(pai) || populacao[0].getBytesProprios() != 0) {
+        std::cout << "Clones não compartilham o bloco do pai" << std::endl;
+        sucesso = false;
+    }
+
+    // Duas mutações seguidas, a segunda intercalando com as diferenças da primeira
+    RedeNeural referencia = original;
+    Xoshiro256 geradorReferencia(8), geradorMutante(8);
+    RedeCompartilhada& mutante = populacao[1];
+    for(int vez = 0; vez < 2; vez++) {
+        referencia.modificarPesos(0.3, 0.02, geradorReferencia);
+        mutante.mutar(0.3, 0.02, geradorMutante);
+    }
+    if(mutante.getNumDeltas() == 0 || mutante.getNumDeltas() * RedeCompartilhada::LIMITE_DELTA > original.getNumParametros() ||
+       !mutante.compartilhaBase(pai) || arena.getBlocosEmUso() != 1) {
+        std::cout << "Mutante não ficou como diferenças sobre a base" << std::endl;
+        sucesso = false;
+    }
+
+    RedeNeural materializada(1, 0, 1);
+    mutante.copiarPara(materializada);
+    for(size_t i = 0; i < referencia.getNumParametros(); i++) {
+        if(std::abs(materializada.getParametros()[i] - referencia.getParametros()[i]) > 1e-12) {
+            std::cout << "Peso " << i << " do mutante diferente de modificarPesos()" << std::endl;
+            sucesso = false;
+            break;
+        }
+    }
+
+    // Saída com a correção esparsa, antes e depois de materializar, e o pai intacto
+    AreaTrabalho area = mutante.criarAreaTrabalho(), areaReferencia = referencia.criarAreaTrabalho();
+    std::vector<double> inputs(20);
+    for(int amostra = 0; amostra < 10; amostra++) {
+        for(int i = 0; i < 20; i++) inputs[i] = ((amostra * 5 + i * 7) % 13) / 6.5 - 1.0;
+        bool saidaMutante[5], saidaReferencia[5], saidaPai[5], saidaOriginal[5];
+        double valoresMutante[5], valoresReferencia[5], valoresPai[5], valoresOriginal[5];
+        mutante.iniciar(inputs.data(), inputs.size(), saidaMutante, area, valoresMutante);
+        referencia.iniciar(inputs.data(), inputs.size(), saidaReferencia, areaReferencia, valoresReferencia);
+        pai.iniciar(inputs.data(), inputs.size(), saidaPai, area, valoresPai);
+        original.iniciar(inputs.data(), inputs.size(), saidaOriginal, areaReferencia, valoresOriginal);
+        for(int n = 0; n < 5; n++) {
+            if(std::abs(valoresMutante[n] - valoresReferencia[n]) > 1e-9 || std::abs(valoresPai[n] - valoresOriginal[n]) > 1e-9) {
+                std::cout << "Saída da rede compartilhada diferente na amostra " << amostra << std::endl;
+                sucesso = false;
+            }
+        }
+    }
+
+    mutante.materializar();
+    bool saidas[5];
+    double valores[5], valoresReferencia[5];
+    mutante.iniciar(inputs.data(), inputs.size(), saidas, area, valores);
+    referencia.iniciar(inputs.data(), inputs.size(), saidas, areaReferencia, valoresReferencia);
+    if(mutante.getNumDeltas() != 0 || mutante.compartilhaBase(pai) || arena.getBlocosEmUso() != 2 ||
+       std::abs(valores[0] - valoresReferencia[0]) > 1e-12) {
+        std::cout << "materializar() não gerou um bloco próprio equivalente" << std::endl;
+        sucesso = false;
+    }
+
+    // Taxa alta passa do limite e materializa sozinha; blocos liberados voltam para a arena e são reaproveitados
+    populacao[2].mutar(0.1, 0.5, geradorMutante);
+    std::size_t reservados = arena.getBytesReservados();
+    populacao.clear();
+    RedeCompartilhada outro(original, arena);
+    if(arena.getBlocosEmUso() != 2 || arena.getBytesReservados() != reservados) {
+        std::cout << "Arena não reaproveitou os blocos liberados" << std::endl;
+        sucesso = false;
+    }
+
+    AreaTrabalho pequena;
+    if(outro.iniciar(inputs.data(), inputs.size(), saidas, pequena) || outro.iniciar(inputs.data(), 19, saidas, area)) {
+        std::cout << "Entrada ou área inválida foi aceita" << std::endl;
+        sucesso = false;
+    }
+    return sucesso;
+}
+
+// Testa o fluxo de lotes lendo o mesmo conjunto do arquivo binário mapeado e do CSV, e a avaliação de uma população por ele
+bool testarConjuntoDados() {
+    const std::string caminhoBinario = "teste_rede_amostras.bin";
+    const std::string caminhoCsv = "teste_rede_amostras.csv";
+    const int entrada = 5, saida = 2, amostras = 1000, tamanhoLote = 64;
+    bool sucesso = true;
+
+    std::vector<double> inputs(amostras * entrada), alvos(amostras * saida);
+    Xoshiro256 gerador(15);
+    gerador.preencherUniforme(inputs.data(), static_cast<int>(inputs.size()), -1.0, 1.0);
+    for(int i = 0; i < amostras; i++) {
+        alvos[i * saida] = inputs[i * entrada] > 0 ? 1.0 : 0.0;
+        alvos[i * saida + 1] = i;
+    }
+
+    // Percorre o fluxo inteiro e confere ordem, conteúdo, alinhamento e o último lote parcial
+    auto conferirFluxo = [&](FluxoLotes& fluxo, const char* nome) {
+        int lidas = 0, numLotes = 0;
+        while(const LoteAmostras* lote = fluxo.proximo()) {
+            if(reinterpret_cast<uintptr_t>(lote->inputs.data()) % ALINHAMENTO != 0 || lote->primeira != static_cast<size_t>(lidas) ||
+               lote->amostras != std::min(tamanhoLote, amostras - lidas) ||
+               !std::equal(lote->getInputs(0), lote->getInputs(0) + lote->amostras * entrada, inputs.begin() + lidas * entrada) ||
+               !std::equal(lote->getAlvos(0), lote->getAlvos(0) + lote->amostras * saida, alvos.begin() + lidas * saida)) {
+                std::cout << "Lote " << numLotes << " do " << nome << " diferente das amostras gravadas" << std::endl;
+                return false;
+            }
+            lidas += lote->amostras;
+            numLotes++;
+        }
+        if(lidas != amostras || numLotes != (amostras + tamanhoLote - 1) / tamanhoLote || !fluxo.getErro().empty()) {
+            std::cout << "Fluxo " << nome << " leu " << lidas << " amostras: " << fluxo.getErro() << std::endl;
+            return false;
+        }
+        return true;
+    };
+
+    if(!salvarAmostras(caminhoBinario, inputs.data(), alvos.data(), amostras, entrada, saida)) {
+        std::cout << "Não foi possível salvar as amostras" << std::endl;
+        return false;
+    }
+    {
+        ConjuntoMapeado conjunto;
+        if(!conjunto.abrir(caminhoBinario) || conjunto.getNumAmostras() != static_cast<size_t>(amostras) ||
+           conjunto.getInputs(999)[4] != inputs[999 * entrada + 4] || conjunto.getAlvos(500)[1] != 500.0) {
+            std::cout << "Amostras mapeadas diferentes das gravadas: " << conjunto.getErro() << std::endl;
+            sucesso = false;
+        }
+
+        std::unique_ptr<LeitorMapeado> leitor(new LeitorMapeado());
+        if(!leitor->abrir(caminhoBinario)) {
+            std::cout << "Não foi possível abrir o leitor mapeado: " << leitor->getErro() << std::endl;
+            std::remove(caminhoBinario.c_str());
+            return false;
+        }
+        FluxoLotes fluxo(std::move(leitor), tamanhoLote, 3);
+        sucesso = conferirFluxo(fluxo, "binário") && sucesso;
+        // Segunda época depois de reiniciar
+        sucesso = fluxo.reiniciar() && conferirFluxo(fluxo, "binário reiniciado") && sucesso;
+
+        // Aptidão de uma população pelo fluxo igual à calculada amostra por amostra
+        std::vector<RedeNeural> populacao;
+        std::vector<const RedeNeural*> redes;
+        for(int r = 0; r < 6; r++) populacao.push_back(RedeNeural(entrada, 1, saida, 40 + r));
+        for(const auto& rede : populacao) redes.push_back(&rede);
+        FuncaoPontuacao acertos = [](const double* valores, const double* alvos, int) {
+            return (valores[0] > 0) == (alvos[0] > 0.5) ? 1.0 : 0.0;
+        };
+        PoolTrabalho pool(3);
+        std::vector<double> aptidoes;
+        fluxo.reiniciar();
+        if(!avaliarConjunto(redes, fluxo, acertos, pool, aptidoes) || aptidoes.size() != redes.size()) {
+            std::cout << "avaliarConjunto falhou" << std::endl;
+            sucesso = false;
+        } else {
+            for(size_t r = 0; r < redes.size(); r++) {
+                AreaTrabalho area = redes[r]->criarAreaTrabalho();
+                double esperado = 0;
+                for(int i = 0; i < amostras; i++) {
+                    bool saidas[saida];
+                    double valores[saida];
+                    redes[r]->iniciar(&inputs[i * entrada], entrada, saidas, area, valores);
+                    esperado += acertos(valores, &alvos[i * saida], saida);
+                }
+                if(aptidoes[r] != esperado) {
+                    std::cout << "Aptidão da rede " << r << " pelo fluxo: " << aptidoes[r] << ", esperado " << esperado << std::endl;
+                    sucesso = false;
+                }
+            }
+        }
+
+        std::vector<const RedeNeural*> outra(1, &populacao[0]);
+        RedeNeural errada(4, 1, saida);
+        outra.push_back(&errada);
+        fluxo.reiniciar();
+        if(avaliarConjunto(outra, fluxo, acertos, pool, aptidoes)) {
+            std::cout << "Rede com outra entrada foi aceita" << std::endl;
+            sucesso = false;
+        }
+    }
+
+    // O mesmo conjunto em CSV, com linha vazia antes do cabeçalho, linha vazia no meio e \r\n
+    {
+        std::ofstream csv(caminhoCsv.c_str());
+        csv << "\nx0,x1,x2,x3,x4,classe,indice\n" << std::setprecision(17);
+        for(int i = 0; i < amostras; i++) {
+            for(int j = 0; j < entrada; j++) csv << inputs[i * entrada + j] << ",";
+            csv << alvos[i * saida] << ", " << alvos[i * saida + 1] << (i % 2 ? "\r\n" : "\n");
+            if(i == 10) csv << "\n";
+        }
+    }
+    {
+        std::unique_ptr<LeitorCsv> leitor(new LeitorCsv(entrada, saida));
+        if(!leitor->abrir(caminhoCsv)) {
+            std::cout << "Não foi possível abrir o CSV" << std::endl;
+            sucesso = false;
+        } else {
+            FluxoLotes fluxo(std::move(leitor), tamanhoLote);
+            sucesso = conferirFluxo(fluxo, "CSV") && sucesso;
+            sucesso = fluxo.reiniciar() && conferirFluxo(fluxo, "CSV reiniciado") && sucesso;
+        }
+    }
+
+    // Linha com coluna faltando para a leitura com erro
+    {
+        std::ofstream csv(caminhoCsv.c_str(), std::ios::app);
+        csv << "1,2,3\n";
+    }
+    {
+        std::unique_ptr<LeitorCsv> leitor(new LeitorCsv(entrada, saida));
+        leitor->abrir(caminhoCsv);
+        FluxoLotes fluxo(std::move(leitor), tamanhoLote);
+        int lidas = 0;
+        while(const LoteAmostras* lote = fluxo.proximo()) lidas += lote->amostras;
+        if(lidas != amostras || fluxo.getErro().empty()) {
+            std::cout << "Linha inválida do CSV não foi detectada" << std::endl;
+            sucesso = false;
+        }
+    }
+
+    // Arquivo binário cortado deve ser recusado
+    {
+        std::ifstream entradaArquivo(caminhoBinario.c_str(), std::ios::binary);
+        std::string conteudo((std::istreambuf_iterator<char>(entradaArquivo)), std::istreambuf_iterator<char>());
+        std::ofstream saidaArquivo(caminhoBinario.c_str(), std::ios::binary | std::ios::trunc);
+        saidaArquivo.write(conteudo.data(), conteudo.size() - 8);
+    }
+    LeitorMapeado cortado;
+    if(cortado.abrir(caminhoBinario)) {
+        std::cout << "Amostras truncadas foram aceitas" << std::endl;
+        sucesso = false;
+    }
+
+    std::remove(caminhoBinario.c_str());
+    std::remove(caminhoCsv.c_str());
+    return sucesso;
+}
+
 int main() {
     std::cout << "Iniciando testes da Rede Neural..." << std::endl << std::endl;
     
@@ -206,6 +1484,23 @@ int main() {
     imprimirResultadoTeste("Teste de Modificação de Pesos", testarModificacaoPesos());
     imprimirResultadoTeste("Teste de Propagação", testarPropagacao());
     imprimirResultadoTeste("Teste de Truncamento", testarTruncamento());
+    imprimirResultadoTeste("Teste de Layout Contíguo", testarLayoutContiguo());
+    imprimirResultadoTeste("Teste de Truncamento sem Cópia", testarTruncamentoSemCopia());
+    imprimirResultadoTeste("Teste de Modelo Binário", testarModeloBinario());
+    imprimirResultadoTeste("Teste de Lote", testarLote());
+    imprimirResultadoTeste("Teste de Kernels SIMD", testarKernels());
+    imprimirResultadoTeste("Teste de Rede Reduzida", testarRedeReduzida());
+    imprimirResultadoTeste("Teste de Rede Podada", testarRedePodada());
+    imprimirResultadoTeste("Teste de Rede Estática", testarRedeEstatica());
+    imprimirResultadoTeste("Teste de Iniciar Reentrante", testarIniciarReentrante());
+    imprimirResultadoTeste("Teste de Iniciar Paralelo", testarIniciarParalelo());
+    imprimirResultadoTeste("Teste de Pool de Trabalho", testarPoolTrabalho());
+    imprimirResultadoTeste("Teste de Gerador Semeável", testarGeradorSemeavel());
+    imprimirResultadoTeste("Teste de Neuroevolução", testarNeuroevolucao());
+    imprimirResultadoTeste("Teste de Treinamento por Gradiente", testarTreinamento());
+    imprimirResultadoTeste("Teste de Rede Compartilhada", testarRedeCompartilhada());
+    imprimirResultadoTeste("Teste de Conjunto de Dados", testarConjuntoDados());
+    imprimirResultadoTeste("Teste de Instrumentação", testarInstrumentacao());
     
     return 0;
 }
\ No newline at end of file
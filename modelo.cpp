@@ -0,0 +1,187 @@
+#include "modelo.hpp"
+#include <fstream>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static const char MAGICA_MODELO[8] = {'R', 'E', 'D', 'E', 'N', 'E', 'U', 'R'};
+
+static uint64_t alinhar(uint64_t offset) {
+    return (offset + ALINHAMENTO - 1) / ALINHAMENTO * ALINHAMENTO;
+}
+
+bool salvarModelo(const std::string& caminho, const std::vector<const RedeNeural*>& redes) {
+    // Primeiro calcula onde fica cada parte, depois grava tudo em sequência
+    std::vector<EntradaModelo> diretorio(redes.size());
+    std::vector<std::vector<uint32_t>> larguras(redes.size());
+    uint64_t offset = sizeof(CabecalhoModelo) + redes.size() * sizeof(EntradaModelo);
+
+    for(size_t r = 0; r < redes.size(); r++) {
+        for(int largura : redes[r]->getLarguras()) {
+            larguras[r].push_back(static_cast<uint32_t>(largura));
+        }
+        diretorio[r].offsetLarguras = offset;
+        diretorio[r].numLarguras = static_cast<uint32_t>(larguras[r].size());
+        diretorio[r].reservado = 0;
+        offset += larguras[r].size() * sizeof(uint32_t);
+    }
+    for(size_t r = 0; r < redes.size(); r++) {
+        offset = alinhar(offset);
+        diretorio[r].offsetParametros = offset;
+        diretorio[r].numParametros = redes[r]->getNumParametros();
+        offset += diretorio[r].numParametros * sizeof(double);
+    }
+
+    CabecalhoModelo cabecalho;
+    std::memset(&cabecalho, 0, sizeof(cabecalho));
+    std::memcpy(cabecalho.magica, MAGICA_MODELO, sizeof(MAGICA_MODELO));
+    cabecalho.versao = VERSAO_MODELO;
+    cabecalho.marcaEndian = MARCA_ENDIAN;
+    cabecalho.larguraSimd = LARGURA_SIMD;
+    cabecalho.bytesValor = sizeof(double);
+    cabecalho.numRedes = redes.size();
+    cabecalho.tamanhoArquivo = offset;
+
+    std::ofstream arquivo(caminho.c_str(), std::ios::binary | std::ios::trunc);
+    if(!arquivo) return false;
+
+    arquivo.write(reinterpret_cast<const char*>(&cabecalho), sizeof(cabecalho));
+    arquivo.write(reinterpret_cast<const char*>(diretorio.data()), diretorio.size() * sizeof(EntradaModelo));
+    for(const auto& l : larguras) {
+        arquivo.write(reinterpret_cast<const char*>(l.data()), l.size() * sizeof(uint32_t));
+    }
+
+    static const char zeros[ALINHAMENTO] = {0};
+    for(size_t r = 0; r < redes.size(); r++) {
+        uint64_t posicao = static_cast<uint64_t>(arquivo.tellp());
+        arquivo.write(zeros, diretorio[r].offsetParametros - posicao);
+        arquivo.write(reinterpret_cast<const char*>(redes[r]->getParametros()), diretorio[r].numParametros * sizeof(double));
+    }
+
+    return static_cast<bool>(arquivo);
+}
+
+bool salvarModelo(const std::string& caminho, const RedeNeural& rede) {
+    return salvarModelo(caminho, std::vector<const RedeNeural*>(1, &rede));
+}
+
+ModeloMapeado::ModeloMapeado() : mapa(nullptr), tamanho(0) {
+}
+
+ModeloMapeado::~ModeloMapeado() {
+    fechar();
+}
+
+void ModeloMapeado::fechar() {
+    redes.clear();
+    if(mapa != nullptr) {
+        munmap(mapa, tamanho);
+        mapa = nullptr;
+        tamanho = 0;
+    }
+}
+
+bool ModeloMapeado::falhar(const std::string& mensagem) {
+    fechar();
+    erro = mensagem;
+    return false;
+}
+
+bool ModeloMapeado::abrir(const std::string& caminho) {
+    fechar();
+    erro.clear();
+
+    int descritor = ::open(caminho.c_str(), O_RDONLY);
+    if(descritor < 0) return falhar("não foi possível abrir " + caminho);
+
+    struct stat info;
+    if(fstat(descritor, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(CabecalhoModelo))) {
+        ::close(descritor);
+        return falhar("arquivo menor que o cabeçalho");
+    }
+
+    tamanho = static_cast<std::size_t>(info.st_size);
+    void* endereco = mmap(nullptr, tamanho, PROT_READ, MAP_PRIVATE, descritor, 0);
+    ::close(descritor);  // O mapeamento continua válido sem o descritor
+    if(endereco == MAP_FAILED) {
+        tamanho = 0;
+        return falhar("mmap falhou");
+    }
+    mapa = endereco;
+
+    const char* base = static_cast<const char*>(mapa);
+    CabecalhoModelo cabecalho;
+    std::memcpy(&cabecalho, base, sizeof(cabecalho));
+
+    if(std::memcmp(cabecalho.magica, MAGICA_MODELO, sizeof(MAGICA_MODELO)) != 0) {
+        return falhar("não é um arquivo de modelo");
+    }
+    if(cabecalho.marcaEndian != MARCA_ENDIAN) {
+        return falhar("modelo gravado com outra ordem de bytes");
+    }
+    if(cabecalho.versao != VERSAO_MODELO) {
+        return falhar("versão de modelo não suportada");
+    }
+    if(cabecalho.larguraSimd != static_cast<uint32_t>(LARGURA_SIMD) || cabecalho.bytesValor != sizeof(double)) {
+        return falhar("layout de parâmetros incompatível");
+    }
+    if(cabecalho.tamanhoArquivo != tamanho ||
+       cabecalho.numRedes > (tamanho - sizeof(CabecalhoModelo)) / sizeof(EntradaModelo)) {
+        return falhar("arquivo truncado");
+    }
+
+    const EntradaModelo* diretorio = reinterpret_cast<const EntradaModelo*>(base + sizeof(CabecalhoModelo));
+    for(uint64_t r = 0; r < cabecalho.numRedes; r++) {
+        const EntradaModelo& entrada = diretorio[r];
+
+        // Comparações na forma offset > tamanho || quantidade > (tamanho - offset) / bytes, que não estouram uint64_t
+        if(entrada.numLarguras < 2 || entrada.offsetLarguras % sizeof(uint32_t) != 0 || entrada.offsetLarguras > tamanho ||
+           entrada.numLarguras > (tamanho - entrada.offsetLarguras) / sizeof(uint32_t)) {
+            return falhar("larguras da rede fora do arquivo");
+        }
+        const uint32_t* larguras = reinterpret_cast<const uint32_t*>(base + entrada.offsetLarguras);
+        std::vector<int> topologia;
+        for(uint32_t l = 0; l < entrada.numLarguras; l++) {
+            if(larguras[l] == 0 || larguras[l] > 1u << 24) return falhar("largura de layer inválida");
+            topologia.push_back(static_cast<int>(larguras[l]));
+        }
+
+        if(entrada.offsetParametros % ALINHAMENTO != 0 || entrada.offsetParametros > tamanho) {
+            return falhar("bloco de parâmetros inválido");
+        }
+
+        // calcularCamadas() soma sem checar estouro e larguras escolhidas fazem a soma dar a volta em size_t,
+        // então cada camada é comparada com o espaço que ainda resta no arquivo antes de ser somada
+        const uint64_t limite = (tamanho - entrada.offsetParametros) / sizeof(double);
+        uint64_t contagem = 0;
+        for(size_t l = 1; l < topologia.size(); l++) {
+            const uint64_t pesos = static_cast<uint64_t>(topologia[l]) * arredondarSimd(topologia[l - 1]);
+            const uint64_t bias = arredondarSimd(topologia[l]);
+            if(pesos > limite - contagem || bias > limite - contagem - pesos) {
+                return falhar("bloco de parâmetros inválido");
+            }
+            contagem += pesos + bias;
+        }
+
+        std::size_t numParametros, larguraAtivacao;
+        calcularCamadas(topologia, numParametros, larguraAtivacao);
+        if(entrada.numParametros != numParametros) {
+            return falhar("bloco de parâmetros inválido");
+        }
+
+        redes.push_back(VisaoRede(topologia, reinterpret_cast<const double*>(base + entrada.offsetParametros)));
+    }
+
+    return true;
+}
+
+bool carregarModelo(const std::string& caminho, RedeNeural& rede, std::size_t indice) {
+    ModeloMapeado modelo;
+    if(!modelo.abrir(caminho) || indice >= modelo.getNumRedes()) {
+        return false;
+    }
+    rede.setVisao(modelo.getRede(indice));
+    return true;
+}
@@ -0,0 +1,122 @@
+#include "poolTrabalho.hpp"
+#include <algorithm>
+
+PoolTrabalho::PoolTrabalho(int numThreads) : faixas(numThreads > 0 ? numThreads : std::max(1u, std::thread::hardware_concurrency())) {
+    this->numThreads = static_cast<int>(faixas.size());
+    // A thread 0 é quem chama paraCada(), só as outras são criadas aqui
+    for(int t = 1; t < this->numThreads; t++) {
+        threads.emplace_back(&PoolTrabalho::laco, this, t);
+    }
+}
+
+PoolTrabalho::~PoolTrabalho() {
+    {
+        std::lock_guard<std::mutex> guarda(trava);
+        encerrar = true;
+    }
+    acordar.notify_all();
+    for(auto& thread : threads) {
+        thread.join();
+    }
+}
+
+void PoolTrabalho::laco(int indiceThread) {
+    unsigned long vista = 0;
+    while(true) {
+        const std::function<void(int, int)>* tarefa;
+        {
+            std::unique_lock<std::mutex> guarda(trava);
+            acordar.wait(guarda, [&]() { return encerrar || geracao != vista; });
+            if(encerrar) return;
+            vista = geracao;
+            tarefa = tarefaAtual;
+        }
+
+        trabalhar(indiceThread, *tarefa);
+
+        {
+            std::lock_guard<std::mutex> guarda(trava);
+            if(--threadsAtivas == 0) {
+                terminou.notify_one();
+            }
+        }
+    }
+}
+
+bool PoolTrabalho::pegar(int indiceThread, int& indice) {
+    Faixa& faixa = faixas[indiceThread];
+    std::lock_guard<std::mutex> guarda(faixa.trava);
+    if(faixa.inicio >= faixa.fim) return false;
+    indice = faixa.inicio++;
+    return true;
+}
+
+bool PoolTrabalho::roubar(int indiceThread) {
+    for(int d = 1; d < numThreads; d++) {
+        Faixa& vitima = faixas[(indiceThread + d) % numThreads];
+        int inicio, fim;
+        {
+            std::lock_guard<std::mutex> guarda(vitima.trava);
+            int restante = vitima.fim - vitima.inicio;
+            if(restante <= 0) continue;
+            // Leva a metade de cima, a vítima continua pela metade de baixo
+            int meio = vitima.inicio + restante / 2;
+            inicio = meio;
+            fim = vitima.fim;
+            vitima.fim = meio;
+        }
+        Faixa& propria = faixas[indiceThread];
+        std::lock_guard<std::mutex> guarda(propria.trava);
+        propria.inicio = inicio;
+        propria.fim = fim;
+        return true;
+    }
+    return false;
+}
+
+void PoolTrabalho::trabalhar(int indiceThread, const std::function<void(int, int)>& tarefa) {
+    int indice;
+    do {
+        while(pegar(indiceThread, indice)) {
+            try {
+                tarefa(indice, indiceThread);
+            } catch(...) {
+                std::lock_guard<std::mutex> guarda(trava);
+                if(!erro) erro = std::current_exception();
+            }
+        }
+    } while(roubar(indiceThread));
+}
+
+void PoolTrabalho::paraCada(int quantidade, const std::function<void(int, int)>& tarefa) {
+    if(quantidade <= 0) return;
+
+    // Divide os índices em faixas contíguas, uma por thread
+    for(int t = 0; t < numThreads; t++) {
+        std::lock_guard<std::mutex> guarda(faixas[t].trava);
+        faixas[t].inicio = static_cast<int>(static_cast<long>(quantidade) * t / numThreads);
+        faixas[t].fim = static_cast<int>(static_cast<long>(quantidade) * (t + 1) / numThreads);
+    }
+
+    {
+        std::lock_guard<std::mutex> guarda(trava);
+        tarefaAtual = &tarefa;
+        threadsAtivas = numThreads - 1;
+        erro = nullptr;
+        geracao++;
+    }
+    acordar.notify_all();
+
+    trabalhar(0, tarefa);
+
+    std::exception_ptr erroRodada;
+    {
+        std::unique_lock<std::mutex> guarda(trava);
+        terminou.wait(guarda, [&]() { return threadsAtivas == 0; });
+        tarefaAtual = nullptr;
+        erroRodada = erro;
+    }
+    if(erroRodada) {
+        std::rethrow_exception(erroRodada);
+    }
+}
@@ -0,0 +1,236 @@
+#include "redeCompartilhada.hpp"
+#include "kernels.hpp"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+
+struct ArenaPesos::Estado {
+    std::mutex trava;
+    std::size_t doublesPorPagina;
+    std::vector<double*> paginas;
+    double* livre = nullptr;          // início do espaço ainda não cortado da página atual
+    std::size_t restante = 0;         // doubles ainda não cortados da página atual
+    std::size_t bytesReservados = 0;
+    std::size_t blocosEmUso = 0;
+    std::map<std::size_t, std::vector<double*>> devolvidos;   // blocos liberados, por tamanho
+
+    ~Estado() {
+        for(double* pagina : paginas) {
+            std::free(pagina);
+        }
+    }
+
+    double* reservarPagina(std::size_t quantidade) {
+        void* p = nullptr;
+        if(posix_memalign(&p, ALINHAMENTO, quantidade * sizeof(double)) != 0) {
+            throw std::bad_alloc();
+        }
+        paginas.push_back(static_cast<double*>(p));
+        bytesReservados += quantidade * sizeof(double);
+        REDENEURAL_CONTAR_ALOCACAO(quantidade * sizeof(double));
+        return static_cast<double*>(p);
+    }
+};
+
+ArenaPesos::ArenaPesos(std::size_t doublesPorPagina) : estado(new Estado()) {
+    estado->doublesPorPagina = std::max<std::size_t>(doublesPorPagina, LARGURA_SIMD);
+}
+
+std::shared_ptr<double> ArenaPesos::alocar(std::size_t quantidade) {
+    // Blocos sempre múltiplos de LARGURA_SIMD, assim o próximo corte continua alinhado
+    quantidade = (quantidade + LARGURA_SIMD - 1) / LARGURA_SIMD * LARGURA_SIMD;
+    double* bloco = nullptr;
+    {
+        std::lock_guard<std::mutex> trava(estado->trava);
+        std::vector<double*>& livres = estado->devolvidos[quantidade];
+        if(!livres.empty()) {
+            bloco = livres.back();
+            livres.pop_back();
+        } else if(quantidade > estado->doublesPorPagina) {
+            bloco = estado->reservarPagina(quantidade);
+        } else {
+            if(estado->restante < quantidade) {
+                estado->livre = estado->reservarPagina(estado->doublesPorPagina);
+                estado->restante = estado->doublesPorPagina;
+            }
+            bloco = estado->livre;
+            estado->livre += quantidade;
+            estado->restante -= quantidade;
+        }
+        estado->blocosEmUso++;
+    }
+
+    // O deleter guarda o estado, então a arena vive enquanto houver blocos
+    std::shared_ptr<Estado> dono = estado;
+    return std::shared_ptr<double>(bloco, [dono, quantidade](double* p) {
+        std::lock_guard<std::mutex> trava(dono->trava);
+        dono->devolvidos[quantidade].push_back(p);
+        dono->blocosEmUso--;
+    });
+}
+
+std::size_t ArenaPesos::getBytesReservados() const {
+    std::lock_guard<std::mutex> trava(estado->trava);
+    return estado->bytesReservados;
+}
+
+std::size_t ArenaPesos::getBlocosEmUso() const {
+    std::lock_guard<std::mutex> trava(estado->trava);
+    return estado->blocosEmUso;
+}
+
+constexpr std::size_t RedeCompartilhada::LIMITE_DELTA;
+
+RedeCompartilhada::RedeCompartilhada(const RedeNeural& rede, const ArenaPesos& arena) : arena(arena) {
+    std::shared_ptr<TopologiaCompartilhada> nova(new TopologiaCompartilhada());
+    nova->larguras = rede.getLarguras();
+    nova->camadas = calcularCamadas(nova->larguras, nova->numParametros, nova->larguraAtivacao);
+    topologia = nova;
+
+    std::shared_ptr<double> bloco = this->arena.alocar(nova->numParametros);
+    std::copy(rede.getParametros(), rede.getParametros() + nova->numParametros, bloco.get());
+    base = bloco;
+}
+
+double RedeCompartilhada::pesoAtual(std::size_t indice) const {
+    auto posicao = std::lower_bound(indicesDelta.begin(), indicesDelta.end(), static_cast<uint32_t>(indice));
+    double peso = base.get()[indice];
+    if(posicao != indicesDelta.end() && *posicao == indice) {
+        peso += diferencasDelta[posicao - indicesDelta.begin()];
+    }
+    return peso;
+}
+
+void RedeCompartilhada::mutar(double valor, double taxa, Xoshiro256& gerador) {
+    if(taxa <= 0.0) return;
+
+    // Mesmo sorteio de modificarPesos(), então a mesma semente altera os mesmos pesos com os mesmos valores
+    SorteioMutacao sorteio(gerador, valor, taxa);
+
+    // As alterações novas vão para uma lista separada e depois são intercaladas com as existentes
+    std::vector<std::pair<uint32_t, double>> novas;
+    std::size_t proximo = sorteio.pular();
+    for(const auto& camada : topologia->camadas) {
+        const std::size_t porNeuronio = camada.entradas + 1;
+        const std::size_t tamanho = porNeuronio * camada.neuronios;
+        while(proximo < tamanho) {
+            std::size_t n = proximo / porNeuronio;
+            std::size_t p = proximo % porNeuronio;
+            std::size_t indice = p == static_cast<std::size_t>(camada.entradas)
+                ? camada.offsetBias + n
+                : camada.offsetPesos + n * camada.stride + p;
+
+            const double peso = sorteio.alterar(pesoAtual(indice));
+            novas.push_back(std::make_pair(static_cast<uint32_t>(indice), peso - base.get()[indice]));
+
+            proximo += 1 + sorteio.pular();
+        }
+        proximo -= tamanho;
+    }
+    if(novas.empty()) return;
+
+    // Bias fica depois da matriz, então a ordem do sorteio não é a ordem do bloco
+    std::sort(novas.begin(), novas.end());
+    std::vector<uint32_t> indices;
+    std::vector<double> diferencas;
+    indices.reserve(indicesDelta.size() + novas.size());
+    diferencas.reserve(indicesDelta.size() + novas.size());
+    std::size_t i = 0, j = 0;
+    while(i < indicesDelta.size() || j < novas.size()) {
+        if(j == novas.size() || (i < indicesDelta.size() && indicesDelta[i] < novas[j].first)) {
+            indices.push_back(indicesDelta[i]);
+            diferencas.push_back(diferencasDelta[i]);
+            i++;
+        } else {
+            if(i < indicesDelta.size() && indicesDelta[i] == novas[j].first) i++;  // A alteração nova substitui a antiga
+            indices.push_back(novas[j].first);
+            diferencas.push_back(novas[j].second);
+            j++;
+        }
+    }
+    indicesDelta.swap(indices);
+    diferencasDelta.swap(diferencas);
+
+    if(indicesDelta.size() * LIMITE_DELTA > topologia->numParametros) {
+        materializar();
+    }
+}
+
+void RedeCompartilhada::materializar() {
+    if(indicesDelta.empty()) return;
+
+    std::shared_ptr<double> bloco = arena.alocar(topologia->numParametros);
+    std::copy(base.get(), base.get() + topologia->numParametros, bloco.get());
+    for(std::size_t d = 0; d < indicesDelta.size(); d++) {
+        bloco.get()[indicesDelta[d]] += diferencasDelta[d];
+    }
+    base = bloco;
+    std::vector<uint32_t>().swap(indicesDelta);
+    std::vector<double>().swap(diferencasDelta);
+}
+
+bool RedeCompartilhada::iniciar(const double* inputs, std::size_t quantidade, bool* saidas, AreaTrabalho& area,
+                                double* valores) const {
+    REDENEURAL_MEDIR(OPERACAO_INICIAR);
+    const int entrada = getEntrada();
+    if(quantidade != static_cast<std::size_t>(entrada) || area.largura < topologia->larguraAtivacao) {
+        return false;
+    }
+
+    double* atual = area.atual();
+    double* proximo = area.proximo();
+    std::copy(inputs, inputs + quantidade, atual);
+    std::fill(atual + entrada, atual + arredondarSimd(entrada), 0.0);
+
+    const Kernels& kernels = kernelsAtivos();
+    const double* parametros = base.get();
+    std::size_t d = 0;
+    for(const auto& camada : topologia->camadas) {
+        // Sem diferenças nesta camada é o mesmo caminho da RedeNeural, com o ReLU junto
+        const std::size_t fimCamada = camada.offsetBias + arredondarSimd(camada.neuronios);
+        const bool temDelta = d < indicesDelta.size() && indicesDelta[d] < fimCamada;
+        kernels.camada(parametros + camada.offsetPesos, parametros + camada.offsetBias, atual, proximo,
+                       camada.neuronios, camada.stride, camada.relu && !temDelta);
+
+        if(temDelta) {
+            // Correção esparsa antes do ReLU: (W + D) a = W a + D a
+            for(; d < indicesDelta.size() && indicesDelta[d] < fimCamada; d++) {
+                const std::size_t indice = indicesDelta[d];
+                if(indice >= camada.offsetBias) {
+                    proximo[indice - camada.offsetBias] += diferencasDelta[d];
+                } else {
+                    const std::size_t posicao = indice - camada.offsetPesos;
+                    proximo[posicao / camada.stride] += diferencasDelta[d] * atual[posicao % camada.stride];
+                }
+            }
+            if(camada.relu) {
+                for(int n = 0; n < camada.neuronios; n++) {
+                    if(proximo[n] < 0) proximo[n] = 0;
+                }
+            }
+        }
+        std::fill(proximo + camada.neuronios, proximo + arredondarSimd(camada.neuronios), 0.0);
+        std::swap(atual, proximo);
+    }
+
+    kernels.limiar(atual, saidas, getSaida());
+    if(valores != nullptr) {
+        std::copy(atual, atual + getSaida(), valores);
+    }
+    return true;
+}
+
+AreaTrabalho RedeCompartilhada::criarAreaTrabalho() const {
+    AreaTrabalho area;
+    area.largura = topologia->larguraAtivacao;
+    area.ativacoes.assign(2 * area.largura, 0.0);
+    return area;
+}
+
+void RedeCompartilhada::copiarPara(RedeNeural& destino) const {
+    destino.setVisao(VisaoRede(topologia->larguras, base.get()));
+    for(std::size_t d = 0; d < indicesDelta.size(); d++) {
+        destino.parametros[indicesDelta[d]] += diferencasDelta[d];
+    }
+}
@@ -1,184 +1,665 @@
 #include "redeNeural.hpp"
-#include <random>
-#include <ctime>
+#include "kernels.hpp"
+#include "poolTrabalho.hpp"
+#include <algorithm>
+#include <cmath>
 
 RedeNeural::RedeNeural(int entrada, int numLayers, int saida) {
     this->entrada = entrada;
     this->numLayers = numLayers;
     this->saida = saida;
+    this->larguraAtivacao = 0;
     gerarPesos(entrada, numLayers, saida);
 }
 
+RedeNeural::RedeNeural(int entrada, int numLayers, int saida, uint64_t semente) {
+    this->entrada = entrada;
+    this->numLayers = numLayers;
+    this->saida = saida;
+    this->larguraAtivacao = 0;
+
+    std::vector<int> larguras(numLayers + 2, entrada);
+    larguras.back() = saida;
+    montarTopologia(larguras);
+    Xoshiro256 gerador(semente);
+    preencherPesos(gerador);
+}
+
+RedeNeural::RedeNeural(const VisaoRede& visao) {
+    this->larguraAtivacao = 0;
+    setVisao(visao);
+}
+
 RedeNeural::~RedeNeural() {
 }
 
-std::vector<double> RedeNeural::gerarPesosAleatorios(int quantidade) {
-    std::vector<double> pesos;
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> dis(-1.0, 1.0);
-    
-    for(int i = 0; i < quantidade; i++) {
-        pesos.push_back(dis(gen));
+std::vector<CamadaDensa> calcularCamadas(const std::vector<int>& larguras, std::size_t& numParametros,
+                                         std::size_t& larguraAtivacao) {
+    std::vector<CamadaDensa> camadas;
+    std::size_t offset = 0;
+    int maiorLargura = arredondarSimd(larguras[0]);
+
+    for(size_t l = 1; l < larguras.size(); l++) {
+        CamadaDensa camada;
+        camada.entradas = larguras[l - 1];
+        camada.neuronios = larguras[l];
+        camada.stride = arredondarSimd(camada.entradas);
+        camada.relu = l < larguras.size() - 1;  // Layer de saída sem ReLU
+
+        // Matriz de pesos seguida do bias, os dois começando em um bloco alinhado
+        camada.offsetPesos = offset;
+        offset += static_cast<std::size_t>(camada.neuronios) * camada.stride;
+        camada.offsetBias = offset;
+        offset += arredondarSimd(camada.neuronios);
+
+        maiorLargura = std::max(maiorLargura, arredondarSimd(camada.neuronios));
+        camadas.push_back(camada);
     }
+
+    numParametros = offset;
+    larguraAtivacao = maiorLargura;
+    return camadas;
+}
+
+void RedeNeural::montarTopologia(const std::vector<int>& larguras) {
+    std::size_t numParametros;
+    camadas = calcularCamadas(larguras, numParametros, larguraAtivacao);
+
+    this->entrada = larguras.front();
+    this->numLayers = static_cast<int>(larguras.size()) - 2;
+    this->saida = larguras.back();
+
+    parametros.assign(numParametros, 0.0);
+    areaInterna = criarAreaTrabalho();
+}
+
+AreaTrabalho RedeNeural::criarAreaTrabalho() const {
+    AreaTrabalho area;
+    area.largura = larguraAtivacao;
+    area.ativacoes.assign(2 * larguraAtivacao, 0.0);
+    return area;
+}
+
+std::vector<double> RedeNeural::gerarPesosAleatorios(int quantidade) {
+    std::vector<double> pesos(quantidade);
+    geradorDaThread().preencherUniforme(pesos.data(), quantidade, -1.0, 1.0);
     return pesos;
 }
 
-void RedeNeural::gerarPesos(int entrada, int numLayers, int saida) {
-    // Criar layer de entrada
-    Layer inputLayer;
-    for(int i = 0; i < entrada; i++) {
-        Neuronio n;
-        n.valor = 0;
-        inputLayer.neuronios.push_back(n);
+void RedeNeural::preencherPesos(Xoshiro256& gerador) {
+    for(const auto& camada : camadas) {
+        // Cada neurônio tem um peso para cada neurônio do layer anterior, o preenchimento até stride fica zerado
+        for(int n = 0; n < camada.neuronios; n++) {
+            gerador.preencherUniforme(&parametros[camada.offsetPesos + static_cast<std::size_t>(n) * camada.stride],
+                                      camada.entradas, -1.0, 1.0);
+        }
+        gerador.preencherUniforme(&parametros[camada.offsetBias], camada.neuronios, -1.0, 1.0);
     }
-    // Adicionar neurônio bias na camada de entrada
-    Neuronio biasinput;
-    biasinput.valor = 1.0; // Bias sempre tem valor 1
-    inputLayer.neuronios.push_back(biasinput);
-    rede.layers.push_back(inputLayer);
+}
 
-    // Criar layers ocultas
-    for(int l = 0; l < numLayers; l++) {
-        Layer hiddenLayer;
-        for(int i = 0; i < entrada; i++) {  // Usando mesmo número de neurônios que entrada
-            Neuronio n;
-            n.valor = 0;
-            // Cada neurônio deve ter um peso para cada neurônio do layer anterior (incluindo bias)
-            n.pesos = gerarPesosAleatorios(entrada + 1);
-            hiddenLayer.neuronios.push_back(n);
-        }
-        // Adicionar neurônio bias na camada oculta
-        Neuronio biashidden;
-        biashidden.valor = 1.0;
-        hiddenLayer.neuronios.push_back(biashidden);
-        rede.layers.push_back(hiddenLayer);
-    }
-
-    // Criar layer de saída
-    Layer outputLayer;
-    for(int i = 0; i < saida; i++) {
-        Neuronio n;
-        n.valor = 0;
-        n.pesos = gerarPesosAleatorios(entrada + 1);  // +1 para considerar o bias do layer anterior
-        outputLayer.neuronios.push_back(n);
-    }
-    rede.layers.push_back(outputLayer);
+void RedeNeural::gerarPesos(int entrada, int numLayers, int saida) {
+    REDENEURAL_MEDIR(OPERACAO_GERAR_PESOS);
+    // Layers ocultos usam o mesmo número de neurônios que a entrada
+    std::vector<int> larguras(numLayers + 2, entrada);
+    larguras.back() = saida;
+    montarTopologia(larguras);
+    preencherPesos(geradorDaThread());
 }
 
-void RedeNeural::modificarPesos(double valor) {
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> dis(0.0, 1.0);
-    std::uniform_int_distribution<> signal(0, 1);
+void RedeNeural::modificarPesos(double valor, double taxa) {
+    modificarPesos(valor, taxa, geradorDaThread());
+}
 
-    for(size_t l = 0; l < rede.layers.size(); l++) {
-        for(size_t n = 0; n < rede.layers[l].neuronios.size(); n++) {
-            // Pula a modificação do valor do neurônio se for um bias
-            if(l < rede.layers.size() - 1 && n == rede.layers[l].neuronios.size() - 1) {
-                continue;
-            }
-            
-            // Modifica os pesos normalmente
-            for(auto& peso : rede.layers[l].neuronios[n].pesos) {
-                if(dis(gen) < 0.5) {  // 50% de chance de modificar
-                    double modificacao = signal(gen) ? valor : -valor;
-                    peso += modificacao;
-                    
-                    // Limita o peso ao intervalo [-1, 1]
-                    if(peso > 1.0) peso = 1.0;
-                    else if(peso < -1.0) peso = -1.0;
-                }
-            }
+void RedeNeural::modificarPesos(double valor, double taxa, Xoshiro256& gerador) {
+    if(taxa <= 0.0) return;
+    REDENEURAL_MEDIR(OPERACAO_MODIFICAR_PESOS);
+
+    SorteioMutacao sorteio(gerador, valor, taxa);
+
+    // Percorre os pesos como se cada neurônio fosse a linha [pesos..., bias], sem o preenchimento
+    std::size_t proximo = sorteio.pular();
+    for(const auto& camada : camadas) {
+        const std::size_t porNeuronio = camada.entradas + 1;
+        const std::size_t tamanho = porNeuronio * camada.neuronios;
+        while(proximo < tamanho) {
+            std::size_t n = proximo / porNeuronio;
+            std::size_t p = proximo % porNeuronio;
+            double& peso = p == static_cast<std::size_t>(camada.entradas)
+                ? parametros[camada.offsetBias + n]
+                : parametros[camada.offsetPesos + n * camada.stride + p];
+
+            peso = sorteio.alterar(peso);
+            proximo += 1 + sorteio.pular();
         }
+        proximo -= tamanho;
     }
 }
 
-Rede RedeNeural::truncamento(std::vector<Rede> redes) {
+Rede RedeNeural::truncamento(const std::vector<Rede>& redes) {
     if(redes.empty()) return Rede();
-    
+    REDENEURAL_MEDIR(OPERACAO_TRUNCAMENTO);
+
     Rede mediaRede = redes[0];  // Inicializa com a primeira rede
-    
-    // Para cada layer
-    for(size_t l = 0; l < mediaRede.layers.size(); l++) {
-        // Para cada neurônio
-        for(size_t n = 0; n < mediaRede.layers[l].neuronios.size(); n++) {
-            // Para cada peso
-            for(size_t p = 0; p < mediaRede.layers[l].neuronios[n].pesos.size(); p++) {
-                double somaPesos = 0;
-                // Soma os pesos de todas as redes
-                for(const auto& rede : redes) {
-                    somaPesos += rede.layers[l].neuronios[n].pesos[p];
+
+    // Soma as outras redes uma de cada vez, percorrendo os pesos de cada uma em sequência
+    for(size_t r = 1; r < redes.size(); r++) {
+        for(size_t l = 0; l < mediaRede.layers.size(); l++) {
+            for(size_t n = 0; n < mediaRede.layers[l].neuronios.size(); n++) {
+                std::vector<double>& soma = mediaRede.layers[l].neuronios[n].pesos;
+                const std::vector<double>& pesos = redes[r].layers[l].neuronios[n].pesos;
+                for(size_t p = 0; p < soma.size(); p++) {
+                    soma[p] += pesos[p];
                 }
-                // Calcula a média
-                mediaRede.layers[l].neuronios[n].pesos[p] = somaPesos / redes.size();
             }
         }
     }
-    
+
+    // Calcula a média
+    for(auto& layer : mediaRede.layers) {
+        for(auto& neuronio : layer.neuronios) {
+            for(auto& peso : neuronio.pesos) {
+                peso /= redes.size();
+            }
+        }
+    }
+
     return mediaRede;
 }
 
-std::vector<bool> RedeNeural::iniciar(std::vector<double> inputs) {
-    // Verificar se o número de inputs corresponde ao número de neurônios de entrada (excluindo o bias)
-    if(inputs.size() != rede.layers[0].neuronios.size() - 1) {
+// Tamanho do bloco de parâmetros somado de cada vez: 32 KB de soma, fica no L1 enquanto as redes passam por ele
+static const std::size_t BLOCO_TRUNCAMENTO = 4096;
+
+bool RedeNeural::truncamento(const RedeNeural* const* redes, std::size_t quantidade, const double* aptidoes,
+                             PoolTrabalho* pool) {
+    if(quantidade == 0) return false;
+    REDENEURAL_MEDIR(OPERACAO_TRUNCAMENTO);
+
+    double somaAptidoes = 0.0;
+    for(std::size_t r = 0; r < quantidade; r++) {
+        if(!mesmaTopologia(*redes[r])) return false;
+        double aptidao = aptidoes != nullptr ? aptidoes[r] : 1.0;
+        if(aptidao < 0.0) return false;
+        somaAptidoes += aptidao;
+    }
+    if(somaAptidoes <= 0.0) return false;
+
+    // Uma das redes pode ser esta mesma, então a soma vai para um buffer separado
+    VetorAlinhado media(parametros.size());
+    const std::size_t numBlocos = (parametros.size() + BLOCO_TRUNCAMENTO - 1) / BLOCO_TRUNCAMENTO;
+    auto somarBloco = [&](int bloco, int) {
+        const std::size_t inicio = bloco * BLOCO_TRUNCAMENTO;
+        const std::size_t fim = std::min(inicio + BLOCO_TRUNCAMENTO, parametros.size());
+        double* soma = media.data();
+        std::fill(soma + inicio, soma + fim, 0.0);
+        for(std::size_t r = 0; r < quantidade; r++) {
+            const double fator = (aptidoes != nullptr ? aptidoes[r] : 1.0) / somaAptidoes;
+            const double* pesos = redes[r]->parametros.data();
+            for(std::size_t i = inicio; i < fim; i++) {
+                soma[i] += fator * pesos[i];
+            }
+        }
+    };
+
+    if(pool != nullptr && numBlocos > 1) {
+        pool->paraCada(static_cast<int>(numBlocos), somarBloco);
+    } else {
+        for(std::size_t bloco = 0; bloco < numBlocos; bloco++) {
+            somarBloco(static_cast<int>(bloco), 0);
+        }
+    }
+
+    parametros.swap(media);
+    return true;
+}
+
+bool RedeNeural::mesmaTopologia(const RedeNeural& outra) const {
+    if(camadas.size() != outra.camadas.size()) return false;
+    for(size_t c = 0; c < camadas.size(); c++) {
+        if(camadas[c].entradas != outra.camadas[c].entradas || camadas[c].neuronios != outra.camadas[c].neuronios) {
+            return false;
+        }
+    }
+    return true;
+}
+
+AcumuladorTruncamento::AcumuladorTruncamento(const RedeNeural& modelo)
+    : larguras(modelo.getLarguras()), soma(modelo.getNumParametros(), 0.0), somaPesos(0.0), quantidade(0) {
+}
+
+bool AcumuladorTruncamento::mesmaTopologia(const RedeNeural& rede) const {
+    if(rede.entrada != larguras.front() || rede.camadas.size() + 1 != larguras.size()) return false;
+    for(size_t c = 0; c < rede.camadas.size(); c++) {
+        if(rede.camadas[c].neuronios != larguras[c + 1]) return false;
+    }
+    return true;
+}
+
+bool AcumuladorTruncamento::adicionar(const RedeNeural& rede, double peso) {
+    if(peso < 0.0 || !mesmaTopologia(rede)) return false;
+
+    const double* pesos = rede.getParametros();
+    for(std::size_t i = 0; i < soma.size(); i++) {
+        soma[i] += peso * pesos[i];
+    }
+    somaPesos += peso;
+    quantidade++;
+    return true;
+}
+
+bool AcumuladorTruncamento::resultado(RedeNeural& destino) const {
+    if(quantidade == 0 || somaPesos <= 0.0 || !mesmaTopologia(destino)) return false;
+
+    const double inverso = 1.0 / somaPesos;
+    for(std::size_t i = 0; i < soma.size(); i++) {
+        destino.parametros[i] = soma[i] * inverso;
+    }
+    return true;
+}
+
+void AcumuladorTruncamento::limpar() {
+    std::fill(soma.begin(), soma.end(), 0.0);
+    somaPesos = 0.0;
+    quantidade = 0;
+}
+
+const double* propagarCamadas(const std::vector<CamadaDensa>& camadas, const double* parametros,
+                              double* atual, double* proximo) {
+    const Kernels& kernels = kernelsAtivos();
+    REDENEURAL_INICIAR_CAMADAS();
+    for(size_t c = 0; c < camadas.size(); c++) {
+        const CamadaDensa& camada = camadas[c];
+        // Soma ponderada com layer anterior mais bias, com ReLU nos layers ocultos
+        kernels.camada(parametros + camada.offsetPesos, parametros + camada.offsetBias, atual, proximo,
+                       camada.neuronios, camada.stride, camada.relu);
+        std::fill(proximo + camada.neuronios, proximo + arredondarSimd(camada.neuronios), 0.0);
+        std::swap(atual, proximo);
+        REDENEURAL_FIM_CAMADA(static_cast<int>(c));
+    }
+    return atual;
+}
+
+const double* propagarCamadasParalelo(const std::vector<CamadaDensa>& camadas, const double* parametros,
+                                      double* atual, double* proximo, PoolTrabalho& pool) {
+    const Kernels& kernels = kernelsAtivos();
+    const int numThreads = pool.getNumThreads();
+    REDENEURAL_INICIAR_CAMADAS();
+    for(size_t c = 0; c < camadas.size(); c++) {
+        const CamadaDensa& camada = camadas[c];
+        const double* pesos = parametros + camada.offsetPesos;
+        const double* bias = parametros + camada.offsetBias;
+        const std::size_t numPesos = static_cast<std::size_t>(camada.neuronios) * camada.stride;
+
+        if(numThreads == 1 || numPesos < PESOS_MINIMOS_PARALELO) {
+            kernels.camada(pesos, bias, atual, proximo, camada.neuronios, camada.stride, camada.relu);
+        } else {
+            // Blocos com múltiplos de LARGURA_SIMD neurônios, assim duas threads nunca escrevem na mesma linha de cache da saída;
+            // e pelo menos um bloco por thread quando a camada é menor que numThreads blocos do tamanho do cache
+            int porBloco = static_cast<int>(BYTES_BLOCO_PARALELO / (camada.stride * sizeof(double)));
+            porBloco = std::min(porBloco, (camada.neuronios + numThreads - 1) / numThreads);
+            porBloco = std::max(LARGURA_SIMD, porBloco / LARGURA_SIMD * LARGURA_SIMD);
+            const int numBlocos = (camada.neuronios + porBloco - 1) / porBloco;
+            // A tarefa captura um ponteiro só, assim o std::function não aloca e a chamada continua sem alocação
+            struct Tarefa {
+                const Kernels& kernels;
+                const CamadaDensa& camada;
+                const double* pesos;
+                const double* bias;
+                const double* entrada;
+                double* saida;
+                int porBloco;
+            } tarefa = {kernels, camada, pesos, bias, atual, proximo, porBloco};
+            const Tarefa* t = &tarefa;
+            pool.paraCada(numBlocos, [t](int bloco, int) {
+                const int inicio = bloco * t->porBloco;
+                const int quantidade = std::min(t->porBloco, t->camada.neuronios - inicio);
+                t->kernels.camada(t->pesos + static_cast<std::size_t>(inicio) * t->camada.stride, t->bias + inicio,
+                                  t->entrada, t->saida + inicio, quantidade, t->camada.stride, t->camada.relu);
+            });
+        }
+        std::fill(proximo + camada.neuronios, proximo + arredondarSimd(camada.neuronios), 0.0);
+        std::swap(atual, proximo);
+        REDENEURAL_FIM_CAMADA(static_cast<int>(c));
+    }
+    return atual;
+}
+
+// Caminho comum da inferência const de RedeNeural e VisaoRede, com pool divide as camadas grandes entre as threads
+static bool iniciarCamadas(const std::vector<CamadaDensa>& camadas, const double* parametros, int entrada, int saida,
+                           std::size_t larguraAtivacao, const double* inputs, std::size_t quantidade, bool* saidas,
+                           AreaTrabalho& area, double* valores, PoolTrabalho* pool = nullptr) {
+    REDENEURAL_MEDIR(OPERACAO_INICIAR);
+    // Verificar se o número de inputs corresponde ao número de neurônios de entrada
+    if(quantidade != static_cast<std::size_t>(entrada) || area.largura < larguraAtivacao) {
+        return false;
+    }
+
+    // Definir valores do layer de entrada, o preenchimento até o stride fica zerado
+    double* atual = area.atual();
+    std::copy(inputs, inputs + quantidade, atual);
+    std::fill(atual + entrada, atual + arredondarSimd(entrada), 0.0);
+
+    const double* resultado = pool != nullptr
+        ? propagarCamadasParalelo(camadas, parametros, atual, area.proximo(), *pool)
+        : propagarCamadas(camadas, parametros, atual, area.proximo());
+
+    // Converter último layer para booleanos
+    kernelsAtivos().limiar(resultado, saidas, saida);
+    if(valores != nullptr) {
+        std::copy(resultado, resultado + saida, valores);
+    }
+    return true;
+}
+
+bool RedeNeural::iniciar(const double* inputs, std::size_t quantidade, bool* saidas, AreaTrabalho& area,
+                         double* valores) const {
+    return iniciarCamadas(camadas, parametros.data(), entrada, saida, larguraAtivacao, inputs, quantidade, saidas,
+                          area, valores);
+}
+
+bool RedeNeural::iniciarParalelo(const double* inputs, std::size_t quantidade, bool* saidas, AreaTrabalho& area,
+                                 PoolTrabalho& pool, double* valores) const {
+    return iniciarCamadas(camadas, parametros.data(), entrada, saida, larguraAtivacao, inputs, quantidade, saidas,
+                          area, valores, &pool);
+}
+
+std::vector<bool> RedeNeural::iniciar(const std::vector<double>& inputs) {
+    REDENEURAL_MEDIR(OPERACAO_INICIAR);
+    // Verificar se o número de inputs corresponde ao número de neurônios de entrada
+    if(inputs.size() != static_cast<size_t>(entrada)) {
         return std::vector<bool>();  // Retorna vetor vazio em caso de erro
     }
 
-    // Definir valores do layer de entrada
-    for(size_t i = 0; i < inputs.size(); i++) {
-        rede.layers[0].neuronios[i].valor = inputs[i];
+    double* atual = areaInterna.atual();
+    std::copy(inputs.begin(), inputs.end(), atual);
+    std::fill(atual + entrada, atual + arredondarSimd(entrada), 0.0);
+
+    const double* valores = propagarCamadas(camadas, parametros.data(), atual, areaInterna.proximo());
+
+    // Converter último layer para booleanos
+    std::vector<bool> saida;
+    for(int n = 0; n < this->saida; n++) {
+        saida.push_back(valores[n] > 0);
     }
-    // O último neurônio é o bias, mantemos seu valor como 1
-    rede.layers[0].neuronios.back().valor = 1.0;
 
-    // Processar layers ocultos e de saída
-    for(size_t l = 1; l < rede.layers.size(); l++) {
-        for(size_t n = 0; n < rede.layers[l].neuronios.size(); n++) {
-            // Se for o último neurônio de uma camada que não é a de saída, é um bias
-            if(l < rede.layers.size() - 1 && n == rede.layers[l].neuronios.size() - 1) {
-                rede.layers[l].neuronios[n].valor = 1.0;
-                continue;
+    return saida;
+}
+
+// Tamanho dos blocos do produto em lote. O bloco de amostras é o loop de fora: suas entradas (32 x 256 doubles, 64 KB)
+// e sua saída ficam no L1/L2 enquanto todos os blocos de pesos (64 x 256, 128 KB, no L2) passam por ele, então o custo
+// por amostra não cresce com o lote. Com os pesos por fora, cada bloco de pesos varria o lote inteiro, que sai do cache
+static const int BLOCO_NEURONIOS = 64;
+static const int BLOCO_ENTRADAS = 256;
+static const int BLOCO_AMOSTRAS = 32;
+
+// Bytes de cada matriz de ativação de um pedaço do lote em iniciarLote(): as duas cabem no L2 com um bloco de pesos
+static const std::size_t BYTES_ATIVACOES_LOTE = 128 * 1024;
+
+void RedeNeural::propagarLote(const CamadaDensa& camada, const double* entrada, double* saida, int amostras) const {
+    const double* pesos = parametros.data() + camada.offsetPesos;
+    const double* bias = parametros.data() + camada.offsetBias;
+    const std::size_t strideA = camada.stride;
+    const std::size_t strideC = arredondarSimd(camada.neuronios);
+    const Kernels& kernels = kernelsAtivos();
+
+    // Cada linha de saída começa com o bias e o preenchimento zerado
+    for(int i = 0; i < amostras; i++) {
+        double* linha = saida + i * strideC;
+        std::copy(bias, bias + camada.neuronios, linha);
+        std::fill(linha + camada.neuronios, linha + strideC, 0.0);
+    }
+
+    for(int i0 = 0; i0 < amostras; i0 += BLOCO_AMOSTRAS) {
+        int i1 = std::min(i0 + BLOCO_AMOSTRAS, amostras);
+        for(int j0 = 0; j0 < camada.neuronios; j0 += BLOCO_NEURONIOS) {
+            int j1 = std::min(j0 + BLOCO_NEURONIOS, camada.neuronios);
+            for(int k0 = 0; k0 < camada.stride; k0 += BLOCO_ENTRADAS) {
+                int k1 = std::min(k0 + BLOCO_ENTRADAS, camada.stride);
+
+                int i = i0;
+                for(; i + 4 <= i1; i += 4) {
+                    int j = j0;
+                    for(; j + 4 <= j1; j += 4) {
+                        kernels.bloco4x4(entrada + i * strideA, camada.stride, pesos + j * strideA, camada.stride,
+                                         saida + i * strideC + j, static_cast<int>(strideC), k0, k1);
+                    }
+                    // Neurônios que sobraram do bloco de 4
+                    for(; j < j1; j++) {
+                        const double* w = pesos + j * strideA;
+                        for(int ii = i; ii < i + 4; ii++) {
+                            saida[ii * strideC + j] += kernels.produtoEscalar(entrada + ii * strideA + k0, w + k0, k1 - k0);
+                        }
+                    }
+                }
+                // Amostras que sobraram do bloco de 4
+                for(; i < i1; i++) {
+                    const double* a = entrada + i * strideA;
+                    for(int j = j0; j < j1; j++) {
+                        saida[i * strideC + j] += kernels.produtoEscalar(a + k0, pesos + j * strideA + k0, k1 - k0);
+                    }
+                }
             }
+        }
+    }
+
+    // Aplicar ReLU para layers ocultos. Sem desvio: com sinais aleatórios o if errava metade das previsões
+    // e custava mais que o produto em lotes grandes. O preenchimento já é 0 e entra no mesmo loop vetorizado
+    if(camada.relu) {
+        const std::size_t total = static_cast<std::size_t>(amostras) * strideC;
+        for(std::size_t i = 0; i < total; i++) {
+            saida[i] = saida[i] < 0 ? 0.0 : saida[i];
+        }
+    }
+}
+
+// Matrizes de ativação de iniciarLote(), uma dupla por thread reaproveitada entre chamadas: alocar a cada lote
+// trazia páginas novas (mmap acima de 128 KB) e as faltas de página custavam mais que o produto de lotes pequenos.
+// Têm no máximo o tamanho de um pedaço do lote: BYTES_ATIVACOES_LOTE cada, ou BLOCO_AMOSTRAS linhas nas redes mais largas
+static VetorAlinhado& ativacoesLoteDaThread(int indice, std::size_t tamanho) {
+    static thread_local VetorAlinhado ativacoes[2];
+    if(ativacoes[indice].size() < tamanho) {
+        ativacoes[indice].resize(tamanho);
+    }
+    return ativacoes[indice];
+}
 
-            double soma = 0.0;
-            
-            // Soma ponderada com layer anterior (incluindo o bias)
-            for(size_t prev = 0; prev < rede.layers[l-1].neuronios.size(); prev++) {
-                soma += rede.layers[l-1].neuronios[prev].valor * 
-                       rede.layers[l].neuronios[n].pesos[prev];
+ResultadoLote RedeNeural::iniciarLote(const std::vector<double>& inputs, int amostras) const {
+    if(amostras <= 0 || inputs.size() != static_cast<size_t>(amostras) * entrada) {
+        return ResultadoLote();  // Retorna resultado vazio em caso de erro
+    }
+    return iniciarLote(inputs.data(), amostras);
+}
+
+ResultadoLote RedeNeural::iniciarLote(const double* inputs, int amostras) const {
+    ResultadoLote resultado;
+    iniciarLote(inputs, amostras, resultado);
+    return resultado;
+}
+
+bool RedeNeural::iniciarLote(const double* inputs, int amostras, ResultadoLote& resultado) const {
+    REDENEURAL_MEDIR(OPERACAO_INICIAR_LOTE);
+    if(amostras <= 0 || inputs == nullptr) {
+        resultado.saidas.clear();
+        resultado.valores.clear();
+        return false;
+    }
+
+    // resize() mantém a capacidade, então um resultado reaproveitado não realoca
+    resultado.saidas.resize(static_cast<size_t>(amostras) * saida);
+    resultado.valores.resize(static_cast<size_t>(amostras) * saida);
+
+    // Lotes pequenos: o loop por amostra ganha do produto em blocos
+    if(amostras < LOTE_MINIMO) {
+        double* atual = ativacoesLoteDaThread(0, larguraAtivacao).data();
+        double* proximo = ativacoesLoteDaThread(1, larguraAtivacao).data();
+        for(int i = 0; i < amostras; i++) {
+            std::copy(inputs + i * entrada, inputs + (i + 1) * entrada, atual);
+            std::fill(atual + entrada, atual + arredondarSimd(entrada), 0.0);
+            const double* valores = propagarCamadas(camadas, parametros.data(), atual, proximo);
+            for(int n = 0; n < saida; n++) {
+                resultado.valores[i * saida + n] = valores[n];
+                resultado.saidas[i * saida + n] = valores[n] > 0;
             }
-            
-            // Aplicar ReLU para layers ocultos
-            if(l < rede.layers.size() - 1) {
-                rede.layers[l].neuronios[n].valor = soma > 0 ? soma : 0;
-            } else {
-                rede.layers[l].neuronios[n].valor = soma;  // Layer de saída sem ReLU
+        }
+        return true;
+    }
+
+    // O lote é calculado em pedaços que passam por todas as camadas antes do próximo: as ativações de um pedaço
+    // (BYTES_ATIVACOES_LOTE por matriz) ficam no L2 entre uma camada e a seguinte, e as matrizes têm o tamanho
+    // do pedaço e não do lote, então o custo por amostra não cresce com o lote
+    const int porPedaco = std::max(BLOCO_AMOSTRAS, static_cast<int>(BYTES_ATIVACOES_LOTE / (larguraAtivacao * sizeof(double))) /
+                                                   BLOCO_AMOSTRAS * BLOCO_AMOSTRAS);
+    const int maximo = std::min(amostras, porPedaco);
+    VetorAlinhado& bufferAtual = ativacoesLoteDaThread(0, static_cast<size_t>(maximo) * larguraAtivacao);
+    VetorAlinhado& bufferProximo = ativacoesLoteDaThread(1, static_cast<size_t>(maximo) * larguraAtivacao);
+    const std::size_t strideEntrada = arredondarSimd(entrada);
+    const std::size_t strideSaida = arredondarSimd(saida);
+
+    for(int inicio = 0; inicio < amostras; inicio += porPedaco) {
+        const int quantidade = std::min(porPedaco, amostras - inicio);
+        const double* pedaco = inputs + static_cast<size_t>(inicio) * entrada;
+
+        // Cada linha com o preenchimento até o stride. propagarLote() escreve todas as posições da saída,
+        // então só o preenchimento da entrada precisa ser zerado
+        double* atual = bufferAtual.data();
+        double* proximo = bufferProximo.data();
+        for(int i = 0; i < quantidade; i++) {
+            double* linha = atual + i * strideEntrada;
+            std::copy(pedaco + i * entrada, pedaco + (i + 1) * entrada, linha);
+            std::fill(linha + entrada, linha + strideEntrada, 0.0);
+        }
+
+        for(const auto& camada : camadas) {
+            propagarLote(camada, atual, proximo, quantidade);
+            std::swap(atual, proximo);
+        }
+
+        for(int i = 0; i < quantidade; i++) {
+            const std::size_t linha = static_cast<size_t>(inicio + i) * saida;
+            for(int n = 0; n < saida; n++) {
+                double valor = atual[i * strideSaida + n];
+                resultado.valores[linha + n] = valor;
+                resultado.saidas[linha + n] = valor > 0;
             }
         }
     }
+    return true;
+}
 
-    // Converter último layer para booleanos e zerar todos os valores
-    std::vector<bool> saida;
-    for(const auto& neuronio : rede.layers.back().neuronios) {
-        saida.push_back(neuronio.valor > 0);
+std::vector<int> RedeNeural::getLarguras() const {
+    std::vector<int> larguras(1, entrada);
+    for(const auto& camada : camadas) {
+        larguras.push_back(camada.neuronios);
     }
+    return larguras;
+}
 
-    // Zerar todos os valores dos neurônios, exceto os bias que devem permanecer 1
-    for(size_t l = 0; l < rede.layers.size(); l++) {
-        for(size_t n = 0; n < rede.layers[l].neuronios.size(); n++) {
-            if(l < rede.layers.size() - 1 && n == rede.layers[l].neuronios.size() - 1) {
-                rede.layers[l].neuronios[n].valor = 1.0; // Mantém o bias como 1
-            } else {
-                rede.layers[l].neuronios[n].valor = 0;
-            }
+VisaoRede RedeNeural::getVisao() const {
+    return VisaoRede(getLarguras(), parametros.data());
+}
+
+void RedeNeural::setVisao(const VisaoRede& visao) {
+    std::vector<int> larguras(1, visao.getEntrada());
+    for(const auto& camada : visao.getCamadas()) {
+        larguras.push_back(camada.neuronios);
+    }
+    montarTopologia(larguras);
+    std::copy(visao.getParametros(), visao.getParametros() + parametros.size(), parametros.begin());
+}
+
+VisaoRede::VisaoRede() : parametros(nullptr), entrada(0), saida(0), larguraAtivacao(0) {
+}
+
+VisaoRede::VisaoRede(const std::vector<int>& larguras, const double* parametros) : parametros(parametros) {
+    std::size_t numParametros;
+    camadas = calcularCamadas(larguras, numParametros, larguraAtivacao);
+    entrada = larguras.front();
+    saida = larguras.back();
+}
+
+bool VisaoRede::iniciar(const double* inputs, std::size_t quantidade, bool* saidas, AreaTrabalho& area,
+                        double* valores) const {
+    return iniciarCamadas(camadas, parametros, entrada, saida, larguraAtivacao, inputs, quantidade, saidas,
+                          area, valores);
+}
+
+bool VisaoRede::iniciarParalelo(const double* inputs, std::size_t quantidade, bool* saidas, AreaTrabalho& area,
+                                PoolTrabalho& pool, double* valores) const {
+    return iniciarCamadas(camadas, parametros, entrada, saida, larguraAtivacao, inputs, quantidade, saidas,
+                          area, valores, &pool);
+}
+
+AreaTrabalho VisaoRede::criarAreaTrabalho() const {
+    AreaTrabalho area;
+    area.largura = larguraAtivacao;
+    area.ativacoes.assign(2 * larguraAtivacao, 0.0);
+    return area;
+}
+
+Rede RedeNeural::getRede() const {
+    Rede rede;
+
+    // Layer de entrada: só valores, mais o neurônio bias
+    Layer inputLayer;
+    inputLayer.neuronios.resize(entrada + 1);
+    for(auto& n : inputLayer.neuronios) {
+        n.valor = 0;
+    }
+    inputLayer.neuronios.back().valor = 1.0; // Bias sempre tem valor 1
+    rede.layers.push_back(inputLayer);
+
+    for(const auto& camada : camadas) {
+        Layer layer;
+        for(int n = 0; n < camada.neuronios; n++) {
+            Neuronio neuronio;
+            neuronio.valor = 0;
+            const double* linha = &parametros[camada.offsetPesos + static_cast<std::size_t>(n) * camada.stride];
+            neuronio.pesos.assign(linha, linha + camada.entradas);
+            neuronio.pesos.push_back(parametros[camada.offsetBias + n]);  // Peso do bias do layer anterior
+            layer.neuronios.push_back(neuronio);
+        }
+        // Layers ocultos terminam com o neurônio bias
+        if(camada.relu) {
+            Neuronio bias;
+            bias.valor = 1.0;
+            layer.neuronios.push_back(bias);
         }
+        rede.layers.push_back(layer);
     }
-    
-    return saida;
+    return rede;
 }
 
 bool RedeNeural::setRede(Rede rede) {
-    this->rede = rede;
+    // Precisa ter pelo menos entrada e saída, e a entrada precisa ter o neurônio bias
+    if(rede.layers.size() < 2 || rede.layers[0].neuronios.size() < 2) {
+        return false;
+    }
+
+    std::vector<int> larguras;
+    for(size_t l = 0; l < rede.layers.size(); l++) {
+        int tamanho = static_cast<int>(rede.layers[l].neuronios.size());
+        bool temBias = l < rede.layers.size() - 1;
+        larguras.push_back(temBias ? tamanho - 1 : tamanho);
+    }
+
+    // Cada neurônio precisa de um peso por neurônio do layer anterior, incluindo o bias
+    for(size_t l = 1; l < rede.layers.size(); l++) {
+        if(larguras[l] < 1) return false;
+        for(int n = 0; n < larguras[l]; n++) {
+            if(rede.layers[l].neuronios[n].pesos.size() != static_cast<size_t>(larguras[l - 1] + 1)) {
+                return false;
+            }
+        }
+    }
+
+    montarTopologia(larguras);
+    for(size_t c = 0; c < camadas.size(); c++) {
+        const CamadaDensa& camada = camadas[c];
+        for(int n = 0; n < camada.neuronios; n++) {
+            const std::vector<double>& pesos = rede.layers[c + 1].neuronios[n].pesos;
+            double* linha = &parametros[camada.offsetPesos + static_cast<std::size_t>(n) * camada.stride];
+            std::copy(pesos.begin(), pesos.end() - 1, linha);
+            parametros[camada.offsetBias + n] = pesos.back();
+        }
+    }
     return true;
-}
\ No newline at end of file
+}
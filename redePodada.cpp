@@ -0,0 +1,224 @@
+#include "redePodada.hpp"
+#include "kernels.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+// Menor tempo por chamada em 3 rodadas de pelo menos 50 us cada
+static double medirNs(const std::function<void()>& funcao) {
+    funcao();
+    double melhor = std::numeric_limits<double>::max();
+    for(int rodada = 0; rodada < 3; rodada++) {
+        long repeticoes = 0;
+        double decorrido = 0;
+        auto inicio = std::chrono::steady_clock::now();
+        while(decorrido < 50e3) {
+            funcao();
+            repeticoes++;
+            decorrido = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - inicio).count();
+        }
+        melhor = std::min(melhor, decorrido / repeticoes);
+    }
+    return melhor;
+}
+
+RedePodada::RedePodada() : entrada(0), saida(0), larguraAtivacao(0), pesosOriginais(0), pesosPodados(0) {
+}
+
+RedePodada::RedePodada(const RedeNeural& rede, const ConfiguracaoPoda& config) : RedePodada() {
+    podar(rede, config);
+}
+
+void RedePodada::podar(const RedeNeural& rede, const ConfiguracaoPoda& config) {
+    larguras = rede.getLarguras();
+    entrada = rede.getEntrada();
+    saida = rede.getSaida();
+    std::size_t numParametros;
+    const std::vector<CamadaDensa> origem = calcularCamadas(larguras, numParametros, larguraAtivacao);
+    const double* parametros = rede.getParametros();
+
+    pesosOriginais = 0;
+    for(const auto& camada : origem) {
+        pesosOriginais += static_cast<std::size_t>(camada.entradas) * camada.neuronios;
+    }
+
+    // Remove |w| < limiar; dos pesos com |w| == limiar, remove só empates deles (no PODA_ESPARSIDADE,
+    // para tirar exatamente a fração pedida mesmo com pesos repetidos, ex: os saturados em 0 ou em +-1)
+    double limiar = config.limiar;
+    std::size_t empates = std::numeric_limits<std::size_t>::max();
+    if(config.criterio == PODA_ESPARSIDADE) {
+        const double fracao = std::min(std::max(config.esparsidade, 0.0), 1.0);
+        const std::size_t remover = static_cast<std::size_t>(fracao * pesosOriginais);
+        if(remover == 0) {
+            limiar = -1.0;
+        } else {
+            std::vector<double> magnitudes;
+            magnitudes.reserve(pesosOriginais);
+            for(const auto& camada : origem) {
+                for(int j = 0; j < camada.neuronios; j++) {
+                    const double* linha = parametros + camada.offsetPesos + static_cast<std::size_t>(j) * camada.stride;
+                    for(int i = 0; i < camada.entradas; i++) magnitudes.push_back(std::abs(linha[i]));
+                }
+            }
+            std::nth_element(magnitudes.begin(), magnitudes.begin() + (remover - 1), magnitudes.end());
+            limiar = magnitudes[remover - 1];
+            const std::size_t abaixo = std::count_if(magnitudes.begin(), magnitudes.begin() + (remover - 1),
+                                                     [limiar](double m) { return m < limiar; });
+            empates = remover - abaixo;
+        }
+    }
+
+    camadas.clear();
+    densos.clear();
+    valores.clear();
+    colunas.clear();
+    linhas.clear();
+    pesosPodados = 0;
+
+    const Kernels& kernels = kernelsAtivos();
+    Xoshiro256 gerador(1);
+    for(const auto& camadaOrigem : origem) {
+        CamadaPodada camada;
+        camada.entradas = camadaOrigem.entradas;
+        camada.neuronios = camadaOrigem.neuronios;
+        camada.stride = camadaOrigem.stride;
+        camada.relu = camadaOrigem.relu;
+        camada.naoNulos = 0;
+
+        // As duas formas da camada, a que perder a escolha é descartada
+        VetorAlinhado matriz(static_cast<std::size_t>(camada.neuronios) * camada.stride, 0.0);
+        VetorAlinhado valoresCamada;
+        std::vector<int32_t, AlocadorAlinhado<int32_t>> colunasCamada;
+        std::vector<uint32_t> linhasCamada(1, 0);
+        for(int j = 0; j < camada.neuronios; j++) {
+            const std::size_t inicioLinha = static_cast<std::size_t>(j) * camada.stride;
+            const double* linha = parametros + camadaOrigem.offsetPesos + inicioLinha;
+            for(int i = 0; i < camada.entradas; i++) {
+                const double magnitude = std::abs(linha[i]);
+                if(magnitude < limiar || (magnitude == limiar && empates > 0)) {
+                    if(magnitude == limiar) empates--;
+                    pesosPodados++;
+                    continue;
+                }
+                matriz[inicioLinha + i] = linha[i];
+                valoresCamada.push_back(linha[i]);
+                colunasCamada.push_back(i);
+                camada.naoNulos++;
+            }
+            while(valoresCamada.size() % LARGURA_SIMD != 0) {
+                valoresCamada.push_back(0.0);
+                colunasCamada.push_back(0);
+            }
+            linhasCamada.push_back(static_cast<uint32_t>(valoresCamada.size()));
+        }
+        camada.densidade = static_cast<double>(camada.naoNulos) / (static_cast<double>(camada.entradas) * camada.neuronios);
+
+        const double* bias = parametros + camadaOrigem.offsetBias;
+        if(config.densidadeMaxima >= 0) {
+            camada.esparsa = camada.densidade <= config.densidadeMaxima;
+        } else {
+            // Mede os dois kernels com esta camada e uma entrada qualquer
+            VetorAlinhado ativacao(camada.stride, 0.0), resultado(arredondarSimd(camada.neuronios), 0.0);
+            gerador.preencherUniforme(ativacao.data(), camada.entradas, 0.0, 1.0);
+            const double tempoDenso = medirNs([&]() {
+                kernels.camada(matriz.data(), bias, ativacao.data(), resultado.data(), camada.neuronios, camada.stride,
+                               camada.relu);
+            });
+            const double tempoEsparso = medirNs([&]() {
+                kernels.camadaEsparsa(valoresCamada.data(), colunasCamada.data(), linhasCamada.data(), bias,
+                                      ativacao.data(), resultado.data(), camada.neuronios, camada.relu);
+            });
+            camada.esparsa = tempoEsparso < tempoDenso;
+        }
+
+        if(camada.esparsa) {
+            // valores.size() é sempre múltiplo de LARGURA_SIMD, então cada linha continua alinhada no bloco
+            const uint32_t base = static_cast<uint32_t>(valores.size());
+            camada.offsetPesos = 0;
+            camada.offsetLinhas = linhas.size();
+            valores.insert(valores.end(), valoresCamada.begin(), valoresCamada.end());
+            colunas.insert(colunas.end(), colunasCamada.begin(), colunasCamada.end());
+            for(uint32_t inicio : linhasCamada) linhas.push_back(base + inicio);
+        } else {
+            camada.offsetPesos = densos.size();
+            camada.offsetLinhas = 0;
+            densos.insert(densos.end(), matriz.begin(), matriz.end());
+        }
+        camada.offsetBias = densos.size();
+        densos.insert(densos.end(), bias, bias + camada.neuronios);
+        densos.resize(arredondarSimd(densos.size()), 0.0);
+        camadas.push_back(camada);
+    }
+}
+
+bool RedePodada::iniciar(const double* inputs, std::size_t quantidade, bool* saidas, AreaTrabalho& area,
+                         double* valores) const {
+    if(quantidade != static_cast<std::size_t>(entrada) || area.largura < larguraAtivacao) {
+        return false;
+    }
+
+    double* atual = area.atual();
+    double* proximo = area.proximo();
+    std::copy(inputs, inputs + quantidade, atual);
+    std::fill(atual + entrada, atual + arredondarSimd(entrada), 0.0);
+
+    const Kernels& kernels = kernelsAtivos();
+    for(const auto& camada : camadas) {
+        if(camada.esparsa) {
+            kernels.camadaEsparsa(this->valores.data(), colunas.data(), linhas.data() + camada.offsetLinhas,
+                                  densos.data() + camada.offsetBias, atual, proximo, camada.neuronios, camada.relu);
+        } else {
+            kernels.camada(densos.data() + camada.offsetPesos, densos.data() + camada.offsetBias, atual, proximo,
+                           camada.neuronios, camada.stride, camada.relu);
+        }
+        std::fill(proximo + camada.neuronios, proximo + arredondarSimd(camada.neuronios), 0.0);
+        std::swap(atual, proximo);
+    }
+
+    kernels.limiar(atual, saidas, saida);
+    if(valores != nullptr) {
+        std::copy(atual, atual + saida, valores);
+    }
+    return true;
+}
+
+AreaTrabalho RedePodada::criarAreaTrabalho() const {
+    AreaTrabalho area;
+    area.largura = larguraAtivacao;
+    area.ativacoes.assign(2 * area.largura, 0.0);
+    return area;
+}
+
+void RedePodada::copiarPara(RedeNeural& destino) const {
+    std::size_t numParametros, largura;
+    const std::vector<CamadaDensa> layout = calcularCamadas(larguras, numParametros, largura);
+    VetorAlinhado parametros(numParametros, 0.0);
+    for(std::size_t c = 0; c < camadas.size(); c++) {
+        const CamadaPodada& camada = camadas[c];
+        double* matriz = parametros.data() + layout[c].offsetPesos;
+        if(camada.esparsa) {
+            for(int j = 0; j < camada.neuronios; j++) {
+                // O preenchimento tem valor 0 na coluna 0, somar não muda o peso
+                for(uint32_t k = linhas[camada.offsetLinhas + j]; k < linhas[camada.offsetLinhas + j + 1]; k++) {
+                    matriz[static_cast<std::size_t>(j) * layout[c].stride + colunas[k]] += valores[k];
+                }
+            }
+        } else {
+            std::copy(densos.begin() + camada.offsetPesos,
+                      densos.begin() + camada.offsetPesos + static_cast<std::size_t>(camada.neuronios) * camada.stride, matriz);
+        }
+        std::copy(densos.begin() + camada.offsetBias, densos.begin() + camada.offsetBias + camada.neuronios,
+                  parametros.begin() + layout[c].offsetBias);
+    }
+    destino.setVisao(VisaoRede(larguras, parametros.data()));
+}
+
+RelatorioConcordancia compararConcordancia(const RedeNeural& referencia, const RedePodada& podada,
+                                           const std::vector<double>& inputs, int amostras) {
+    AreaTrabalho area = podada.criarAreaTrabalho();
+    return medirConcordancia(referencia, [&](const double* amostra, bool* saidas, double* valores) {
+        return podada.iniciar(amostra, podada.getEntrada(), saidas, area, valores);
+    }, inputs, amostras);
+}
@@ -0,0 +1,158 @@
+#include "redeReduzida.hpp"
+#include "kernels.hpp"
+#include <algorithm>
+#include <cmath>
+
+// Elementos de T em uma linha de cache: 16 floats ou 64 int8
+template<typename T>
+static int arredondarLinha(int n) {
+    const int porLinha = static_cast<int>(ALINHAMENTO / sizeof(T));
+    return (n + porLinha - 1) / porLinha * porLinha;
+}
+
+// Conversão de uma matriz de pesos double (neuronios x strideOrigem) para T (neuronios x strideDestino), retorna a escala
+static float converterPesos(const double* origem, int neuronios, int entradas, int strideOrigem, float* destino, int strideDestino) {
+    for(int n = 0; n < neuronios; n++) {
+        for(int p = 0; p < entradas; p++) {
+            destino[static_cast<std::size_t>(n) * strideDestino + p] = static_cast<float>(origem[static_cast<std::size_t>(n) * strideOrigem + p]);
+        }
+    }
+    return 1.0f;
+}
+
+static float converterPesos(const double* origem, int neuronios, int entradas, int strideOrigem, int8_t* destino, int strideDestino) {
+    // Uma escala por camada: o maior peso em módulo vira ±127
+    double maior = 0.0;
+    for(int n = 0; n < neuronios; n++) {
+        for(int p = 0; p < entradas; p++) {
+            maior = std::max(maior, std::abs(origem[static_cast<std::size_t>(n) * strideOrigem + p]));
+        }
+    }
+    const double escala = maior > 0.0 ? maior / 127.0 : 1.0;
+    for(int n = 0; n < neuronios; n++) {
+        for(int p = 0; p < entradas; p++) {
+            double q = std::round(origem[static_cast<std::size_t>(n) * strideOrigem + p] / escala);
+            destino[static_cast<std::size_t>(n) * strideDestino + p] = static_cast<int8_t>(std::max(-127.0, std::min(127.0, q)));
+        }
+    }
+    return static_cast<float>(escala);
+}
+
+// Uma camada em float: entrada já com o preenchimento zerado até o stride
+static void propagarCamada(const CamadaReduzida& camada, const float* pesos, const float* bias, const float* entrada,
+                           float* saida, int8_t*, const Kernels& kernels) {
+    for(int n = 0; n < camada.neuronios; n++) {
+        float soma = bias[n] + kernels.produtoEscalarFloat(pesos + static_cast<std::size_t>(n) * camada.stride, entrada, camada.stride);
+        saida[n] = (camada.relu && soma < 0) ? 0 : soma;
+    }
+}
+
+// Uma camada em int8: quantiza a entrada com a escala da amostra e acumula em int32
+static void propagarCamada(const CamadaReduzida& camada, const int8_t* pesos, const float* bias, const float* entrada,
+                           float* saida, int8_t* quantizadas, const Kernels& kernels) {
+    float maior = 0.0f;
+    for(int p = 0; p < camada.entradas; p++) {
+        maior = std::max(maior, std::abs(entrada[p]));
+    }
+    const float escalaEntrada = maior > 0.0f ? maior / 127.0f : 1.0f;
+    const float inverso = 1.0f / escalaEntrada;
+    for(int p = 0; p < camada.entradas; p++) {
+        quantizadas[p] = static_cast<int8_t>(std::lrint(entrada[p] * inverso));
+    }
+    std::fill(quantizadas + camada.entradas, quantizadas + camada.stride, 0);
+
+    const float escala = camada.escala * escalaEntrada;
+    for(int n = 0; n < camada.neuronios; n++) {
+        int32_t produto = kernels.produtoEscalarInt8(pesos + static_cast<std::size_t>(n) * camada.stride, quantizadas, camada.stride);
+        float soma = bias[n] + produto * escala;
+        saida[n] = (camada.relu && soma < 0) ? 0 : soma;
+    }
+}
+
+template<typename T>
+RedeReduzida<T>::RedeReduzida() : entrada(0), saida(0), larguraAtivacao(0) {
+}
+
+template<typename T>
+RedeReduzida<T>::RedeReduzida(const RedeNeural& rede) : entrada(0), saida(0), larguraAtivacao(0) {
+    converter(rede);
+}
+
+template<typename T>
+void RedeReduzida<T>::converter(const RedeNeural& rede) {
+    const std::vector<CamadaDensa>& origem = rede.getCamadas();
+    camadas.clear();
+    entrada = rede.getEntrada();
+    saida = rede.getSaida();
+
+    std::size_t offsetPesos = 0, offsetBias = 0;
+    larguraAtivacao = arredondarLinha<T>(entrada);
+    for(const auto& camadaOrigem : origem) {
+        CamadaReduzida camada;
+        camada.entradas = camadaOrigem.entradas;
+        camada.neuronios = camadaOrigem.neuronios;
+        camada.stride = arredondarLinha<T>(camada.entradas);
+        camada.relu = camadaOrigem.relu;
+        camada.offsetPesos = offsetPesos;
+        camada.offsetBias = offsetBias;
+        camada.escala = 1.0f;
+        offsetPesos += static_cast<std::size_t>(camada.neuronios) * camada.stride;
+        offsetBias += arredondarLinha<float>(camada.neuronios);
+        larguraAtivacao = std::max(larguraAtivacao, static_cast<std::size_t>(arredondarLinha<T>(camada.neuronios)));
+        camadas.push_back(camada);
+    }
+
+    pesos.assign(offsetPesos, T());
+    bias.assign(offsetBias, 0.0f);
+    const double* parametros = rede.getParametros();
+    for(size_t c = 0; c < camadas.size(); c++) {
+        CamadaReduzida& camada = camadas[c];
+        camada.escala = converterPesos(parametros + origem[c].offsetPesos, camada.neuronios, camada.entradas, origem[c].stride,
+                                       pesos.data() + camada.offsetPesos, camada.stride);
+        for(int n = 0; n < camada.neuronios; n++) {
+            bias[camada.offsetBias + n] = static_cast<float>(parametros[origem[c].offsetBias + n]);
+        }
+    }
+}
+
+template<typename T>
+AreaReduzida RedeReduzida<T>::criarAreaTrabalho() const {
+    AreaReduzida area;
+    area.largura = larguraAtivacao;
+    area.ativacoes.assign(2 * larguraAtivacao, 0.0f);
+    area.quantizadas.assign(larguraAtivacao, 0);
+    return area;
+}
+
+template<typename T>
+bool RedeReduzida<T>::iniciar(const double* inputs, std::size_t quantidade, bool* saidas, AreaReduzida& area,
+                              double* valores) const {
+    if(quantidade != static_cast<std::size_t>(entrada) || area.largura < larguraAtivacao) {
+        return false;
+    }
+
+    float* atual = area.ativacoes.data();
+    float* proximo = area.ativacoes.data() + area.largura;
+    for(int i = 0; i < entrada; i++) {
+        atual[i] = static_cast<float>(inputs[i]);
+    }
+    std::fill(atual + entrada, atual + arredondarLinha<T>(entrada), 0.0f);
+
+    const Kernels& kernels = kernelsAtivos();
+    for(const auto& camada : camadas) {
+        propagarCamada(camada, pesos.data() + camada.offsetPesos, bias.data() + camada.offsetBias, atual, proximo,
+                       area.quantizadas.data(), kernels);
+        std::fill(proximo + camada.neuronios, proximo + arredondarLinha<T>(camada.neuronios), 0.0f);
+        std::swap(atual, proximo);
+    }
+
+    // Converter último layer para booleanos
+    for(int n = 0; n < saida; n++) {
+        saidas[n] = atual[n] > 0;
+        if(valores != nullptr) valores[n] = atual[n];
+    }
+    return true;
+}
+
+template class RedeReduzida<float>;
+template class RedeReduzida<int8_t>;
@@ -0,0 +1,260 @@
+#include "treinamento.hpp"
+#include "kernels.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+// Tamanho dos blocos do bloco de parâmetros somados e atualizados de cada vez, igual ao do truncamento
+static const std::size_t BLOCO_GRADIENTE = 4096;
+
+// Perda de uma saída e a derivada em relação ao valor bruto
+static double perdaSaida(FuncaoPerda perda, double valor, double alvo, double& derivada) {
+    if(perda == PERDA_QUADRATICA) {
+        derivada = valor - alvo;
+        return 0.5 * derivada * derivada;
+    }
+    // log(1 + e^valor) - alvo * valor, sem estourar para valores grandes
+    const double sigmoid = valor >= 0 ? 1.0 / (1.0 + std::exp(-valor)) : std::exp(valor) / (1.0 + std::exp(valor));
+    derivada = sigmoid - alvo;
+    return std::max(valor, 0.0) + std::log1p(std::exp(-std::abs(valor))) - alvo * valor;
+}
+
+Treinador::Treinador(RedeNeural& rede, const ConfiguracaoTreinamento& config)
+    : rede(rede), config(config), pool(new PoolTrabalho(config.numThreads)), larguraDelta(0), passos(0) {
+    gerador.semear(config.semente != 0 ? config.semente : geradorDaThread().proximo());
+    this->config.tamanhoLote = std::max(1, config.tamanhoLote);
+    dimensionar();
+}
+
+void Treinador::dimensionar() {
+    const std::vector<CamadaDensa>& camadas = rede.getCamadas();
+    const std::size_t numParametros = rede.getNumParametros();
+    const int numThreads = pool->getNumThreads();
+
+    std::vector<std::size_t> offsets(1, 0);
+    std::size_t largura = arredondarSimd(rede.getEntrada());
+    offsets.push_back(largura);
+    for(const auto& camada : camadas) {
+        offsets.push_back(offsets.back() + arredondarSimd(camada.neuronios));
+        largura = std::max(largura, static_cast<std::size_t>(arredondarSimd(camada.neuronios)));
+    }
+    offsets.pop_back();
+
+    if(!gradientes.empty() && gradientes[0].size() == numParametros && offsets == offsetsAtivacao) {
+        return;
+    }
+
+    offsetsAtivacao = offsets;
+    larguraDelta = largura;
+    const std::size_t tamanhoAtivacoes = offsets.back() + arredondarSimd(camadas.back().neuronios);
+    gradientes.assign(numThreads, VetorAlinhado(numParametros, 0.0));
+    perdas.assign(numThreads, 0.0);
+    ativacoes.assign(numThreads, VetorAlinhado(tamanhoAtivacoes, 0.0));
+    deltas.assign(numThreads, VetorAlinhado(2 * largura, 0.0));
+    momento1.assign(numParametros, 0.0);
+    momento2.assign(numParametros, 0.0);
+    passos = 0;
+}
+
+double Treinador::acumularAmostra(const double* input, const double* alvo, double* gradiente, int thread) {
+    const std::vector<CamadaDensa>& camadas = rede.getCamadas();
+    const double* parametros = rede.getParametros();
+    const Kernels& kernels = kernelsAtivos();
+    double* ativacao = ativacoes[thread].data();
+
+    // Ida: a saída de cada camada fica guardada, a entrada da camada c está em offsetsAtivacao[c]
+    const int entrada = rede.getEntrada();
+    std::copy(input, input + entrada, ativacao);
+    std::fill(ativacao + entrada, ativacao + arredondarSimd(entrada), 0.0);
+    for(size_t c = 0; c < camadas.size(); c++) {
+        const CamadaDensa& camada = camadas[c];
+        double* saida = ativacao + offsetsAtivacao[c + 1];
+        kernels.camada(parametros + camada.offsetPesos, parametros + camada.offsetBias, ativacao + offsetsAtivacao[c],
+                       saida, camada.neuronios, camada.stride, camada.relu);
+        std::fill(saida + camada.neuronios, saida + arredondarSimd(camada.neuronios), 0.0);
+    }
+
+    // Perda e derivada em relação à saída linear
+    const CamadaDensa& ultima = camadas.back();
+    const double* valores = ativacao + offsetsAtivacao[camadas.size()];
+    double* delta = deltas[thread].data();
+    double* deltaAnterior = delta + larguraDelta;
+    double perda = 0.0;
+    for(int n = 0; n < ultima.neuronios; n++) {
+        perda += perdaSaida(config.perda, valores[n], alvo[n], delta[n]);
+    }
+
+    // Volta: gradiente dos pesos de cada camada e derivada em relação à entrada dela
+    for(size_t c = camadas.size(); c-- > 0;) {
+        const CamadaDensa& camada = camadas[c];
+        const double* entradaCamada = ativacao + offsetsAtivacao[c];
+        const double* pesos = parametros + camada.offsetPesos;
+        double* gradientePesos = gradiente + camada.offsetPesos;
+        double* gradienteBias = gradiente + camada.offsetBias;
+
+        if(c > 0) {
+            std::fill(deltaAnterior, deltaAnterior + camada.stride, 0.0);
+        }
+        for(int n = 0; n < camada.neuronios; n++) {
+            const double d = delta[n];
+            if(d == 0.0) continue;  // Neurônio ReLU desligado nesta amostra
+            gradienteBias[n] += d;
+            double* linhaGradiente = gradientePesos + static_cast<std::size_t>(n) * camada.stride;
+            const double* linhaPesos = pesos + static_cast<std::size_t>(n) * camada.stride;
+            for(int p = 0; p < camada.stride; p++) {
+                linhaGradiente[p] += d * entradaCamada[p];
+            }
+            if(c > 0) {
+                for(int p = 0; p < camada.stride; p++) {
+                    deltaAnterior[p] += d * linhaPesos[p];
+                }
+            }
+        }
+
+        if(c > 0) {
+            // Derivada do ReLU da camada anterior: só passa onde a ativação foi positiva
+            for(int p = 0; p < camada.entradas; p++) {
+                if(entradaCamada[p] <= 0.0) deltaAnterior[p] = 0.0;
+            }
+            std::swap(delta, deltaAnterior);
+        }
+    }
+    return perda;
+}
+
+double Treinador::calcularGradiente(const double* inputs, const double* alvos, int amostras) {
+    dimensionar();
+    if(amostras <= 0) return 0.0;
+
+    const int entrada = rede.getEntrada();
+    const int saida = rede.getSaida();
+    const int numPartes = static_cast<int>(gradientes.size());
+
+    // Parte k fica com as amostras [k * amostras / numPartes, (k + 1) * amostras / numPartes)
+    pool->paraCada(numPartes, [&](int parte, int thread) {
+        double* gradiente = gradientes[parte].data();
+        std::fill(gradiente, gradiente + gradientes[parte].size(), 0.0);
+        const int inicio = static_cast<int>(static_cast<long>(parte) * amostras / numPartes);
+        const int fim = static_cast<int>(static_cast<long>(parte + 1) * amostras / numPartes);
+        double perda = 0.0;
+        for(int a = inicio; a < fim; a++) {
+            perda += acumularAmostra(inputs + static_cast<std::size_t>(a) * entrada,
+                                     alvos + static_cast<std::size_t>(a) * saida, gradiente, thread);
+        }
+        perdas[parte] = perda;
+    });
+
+    // Soma das partes em gradientes[0], já dividida pelo número de amostras
+    const std::size_t numParametros = gradientes[0].size();
+    const std::size_t numBlocos = (numParametros + BLOCO_GRADIENTE - 1) / BLOCO_GRADIENTE;
+    const double inverso = 1.0 / amostras;
+    pool->paraCada(static_cast<int>(numBlocos), [&](int bloco, int) {
+        const std::size_t inicio = bloco * BLOCO_GRADIENTE;
+        const std::size_t fim = std::min(inicio + BLOCO_GRADIENTE, numParametros);
+        double* soma = gradientes[0].data();
+        for(int parte = 1; parte < numPartes; parte++) {
+            const double* gradiente = gradientes[parte].data();
+            for(std::size_t i = inicio; i < fim; i++) {
+                soma[i] += gradiente[i];
+            }
+        }
+        for(std::size_t i = inicio; i < fim; i++) {
+            soma[i] *= inverso;
+        }
+    });
+
+    return std::accumulate(perdas.begin(), perdas.end(), 0.0) * inverso;
+}
+
+void Treinador::aplicarGradiente() {
+    dimensionar();
+    passos++;
+
+    double* parametros = rede.parametros.data();
+    const double* gradiente = gradientes[0].data();
+    const std::size_t numParametros = gradientes[0].size();
+    const std::size_t numBlocos = (numParametros + BLOCO_GRADIENTE - 1) / BLOCO_GRADIENTE;
+    const double taxa = config.taxaAprendizado;
+
+    // Correção do viés inicial das médias do Adam
+    const double correcao1 = 1.0 - std::pow(config.beta1, static_cast<double>(passos));
+    const double correcao2 = 1.0 - std::pow(config.beta2, static_cast<double>(passos));
+
+    // O preenchimento tem gradiente zero, então continua zerado nos dois otimizadores
+    pool->paraCada(static_cast<int>(numBlocos), [&](int bloco, int) {
+        const std::size_t inicio = bloco * BLOCO_GRADIENTE;
+        const std::size_t fim = std::min(inicio + BLOCO_GRADIENTE, numParametros);
+        if(config.otimizador == OTIMIZADOR_SGD) {
+            for(std::size_t i = inicio; i < fim; i++) {
+                momento1[i] = config.momento * momento1[i] + gradiente[i];
+                parametros[i] -= taxa * momento1[i];
+            }
+        } else {
+            for(std::size_t i = inicio; i < fim; i++) {
+                momento1[i] = config.beta1 * momento1[i] + (1.0 - config.beta1) * gradiente[i];
+                momento2[i] = config.beta2 * momento2[i] + (1.0 - config.beta2) * gradiente[i] * gradiente[i];
+                parametros[i] -= taxa * (momento1[i] / correcao1) / (std::sqrt(momento2[i] / correcao2) + config.epsilon);
+            }
+        }
+    });
+}
+
+double Treinador::treinarLote(const double* inputs, const double* alvos, int amostras) {
+    double perda = calcularGradiente(inputs, alvos, amostras);
+    if(amostras > 0) aplicarGradiente();
+    return perda;
+}
+
+double Treinador::treinarEpoca(const std::vector<double>& inputs, const std::vector<double>& alvos, int amostras) {
+    const int entrada = rede.getEntrada();
+    const int saida = rede.getSaida();
+    if(amostras <= 0 || inputs.size() != static_cast<std::size_t>(amostras) * entrada ||
+       alvos.size() != static_cast<std::size_t>(amostras) * saida) {
+        return -1.0;
+    }
+
+    // Embaralhamento de Fisher-Yates
+    ordem.resize(amostras);
+    std::iota(ordem.begin(), ordem.end(), 0);
+    for(int i = amostras - 1; i > 0; i--) {
+        std::swap(ordem[i], ordem[gerador.intervalo(i + 1)]);
+    }
+
+    const int tamanhoLote = config.tamanhoLote;
+    loteInputs.resize(static_cast<std::size_t>(tamanhoLote) * entrada);
+    loteAlvos.resize(static_cast<std::size_t>(tamanhoLote) * saida);
+    double perdaTotal = 0.0;
+    for(int inicio = 0; inicio < amostras; inicio += tamanhoLote) {
+        const int quantidade = std::min(tamanhoLote, amostras - inicio);
+        for(int i = 0; i < quantidade; i++) {
+            const std::size_t amostra = ordem[inicio + i];
+            std::copy(inputs.begin() + amostra * entrada, inputs.begin() + (amostra + 1) * entrada,
+                      loteInputs.begin() + static_cast<std::size_t>(i) * entrada);
+            std::copy(alvos.begin() + amostra * saida, alvos.begin() + (amostra + 1) * saida,
+                      loteAlvos.begin() + static_cast<std::size_t>(i) * saida);
+        }
+        perdaTotal += treinarLote(loteInputs.data(), loteAlvos.data(), quantidade) * quantidade;
+    }
+    return perdaTotal / amostras;
+}
+
+double Treinador::calcularPerda(const std::vector<double>& inputs, const std::vector<double>& alvos, int amostras) const {
+    const int entrada = rede.getEntrada();
+    const int saida = rede.getSaida();
+    if(amostras <= 0 || inputs.size() != static_cast<std::size_t>(amostras) * entrada ||
+       alvos.size() != static_cast<std::size_t>(amostras) * saida) {
+        return -1.0;
+    }
+
+    AreaTrabalho area = rede.criarAreaTrabalho();
+    std::vector<double> valores(saida);
+    std::unique_ptr<bool[]> saidas(new bool[saida]);
+    double perda = 0.0, derivada;
+    for(int a = 0; a < amostras; a++) {
+        rede.iniciar(inputs.data() + static_cast<std::size_t>(a) * entrada, entrada, saidas.get(), area, valores.data());
+        for(int n = 0; n < saida; n++) {
+            perda += perdaSaida(config.perda, valores[n], alvos[static_cast<std::size_t>(a) * saida + n], derivada);
+        }
+    }
+    return perda / amostras;
+}